@@ -0,0 +1,76 @@
+/*
+ * Host benchmark runner, see bench.h.
+ *
+ *	usage: bench [-q] [filter]
+ *
+ * -q runs each benchmark for a few milliseconds only (used by ctest);
+ * filter restricts the run to benchmarks whose name contains it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+
+volatile long bench_sink;
+
+static const struct bench *tables[] = {
+	print_benches,
+	queue_benches,
+	sched_benches,
+	disk_benches,
+	trap_benches,
+	thread_benches,
+};
+
+static double
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+run(const struct bench *b, double target_ns)
+{
+	long n = 1;
+	long bytes;
+	double t0, dt;
+
+	for (;;) {
+		t0 = now_ns();
+		bytes = b->fn(n, b->arg);
+		dt = now_ns() - t0;
+		if (dt >= target_ns || n >= (1L << 40))
+			break;
+		n = dt > 0 && dt * 100 > target_ns ? (long)(n * target_ns / dt * 1.2) : n * 100;
+	}
+
+	printf("%-28s %12ld %10.2f ns/op %6ld bytes/op\n",
+	       b->name, n, dt / n, bytes);
+}
+
+int
+main(int argc, char **argv)
+{
+	double target_ns = 200e6;
+	const char *filter = NULL;
+	const struct bench *b;
+	unsigned i;
+
+	for (i = 1; i < (unsigned)argc; i++) {
+		if (strcmp(argv[i], "-q") == 0)
+			target_ns = 5e6;
+		else
+			filter = argv[i];
+	}
+
+	for (i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+		for (b = tables[i]; b->name; b++)
+			if (!filter || strstr(b->name, filter))
+				run(b, target_ns);
+
+	return 0;
+}
@@ -0,0 +1,30 @@
+/*
+ * Host benchmark harness for the kernel library.
+ *
+ * Every benchmark runs its operation n times and returns the payload of
+ * a single operation in bytes: characters emitted for formatting, link
+ * bytes rewritten for list operations.  The runner grows n until a run
+ * takes long enough to time and reports ns/op and bytes/op.
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+struct bench {
+	const char *name;
+	long (*fn)(long n, const void *arg);
+	const void *arg;
+};
+
+/* Tables terminated by an entry with a NULL name. */
+extern const struct bench print_benches[];
+extern const struct bench queue_benches[];
+extern const struct bench sched_benches[];
+extern const struct bench disk_benches[];
+extern const struct bench trap_benches[];
+extern const struct bench thread_benches[];
+
+/* Keeps the compiler from optimizing a result away. */
+extern volatile long bench_sink;
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,63 @@
+/*
+ * Disk queue benchmarks against the host RAM disk: a sequential read
+ * submitted a sector at a time, which the elevator runs as one batch,
+ * and the same sectors in scattered order.
+ */
+
+#include <disk.h>
+#include "bench.h"
+
+#define NREQ	32
+
+static struct disk_req reqs[NREQ];
+static u_int bufs[NREQ][SECT_SIZE / 4];
+
+static void
+submit(int i, u_int secno)
+{
+	struct disk_req *r = &reqs[i];
+
+	r->dr_diskno = 0;
+	r->dr_secno = secno;
+	r->dr_write = 0;
+	r->dr_niov = 1;
+	r->dr_iov[0].iov_base = bufs[i];
+	r->dr_iov[0].iov_nsecs = 1;
+	disk_submit(r);
+}
+
+static long
+bench_seq(long n, const void *arg)
+{
+	long i;
+	int j;
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < NREQ; j++)
+			submit(j, j);
+		disk_run();
+	}
+	bench_sink += disk_stats.ds_batches;
+	return NREQ * SECT_SIZE;
+}
+
+static long
+bench_scattered(long n, const void *arg)
+{
+	long i;
+	int j;
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < NREQ; j++)
+			submit(j, j * 97 % 4096);
+		disk_run();
+	}
+	bench_sink += disk_stats.ds_batches;
+	return NREQ * SECT_SIZE;
+}
+
+const struct bench disk_benches[] = {
+	{ "disk/sequential", bench_seq, NULL },
+	{ "disk/scattered", bench_scattered, NULL },
+	{ NULL },
+};
@@ -0,0 +1,164 @@
+/*
+ * lp_Print() benchmarks.
+ */
+
+#include <stddef.h>
+#include <print.h>
+#include <printf.h>
+#include <cons.h>
+#include "../test.h"
+#include "bench.h"
+
+struct print_case {
+	char *fmt;
+	long num;
+	char *str;
+};
+
+static long out_bytes;
+
+/* Counts what lp_Print() emits; the termination call adds 0. */
+static void
+count_output(void *arg, char *s, int l)
+{
+	*(long *)arg += l;
+}
+
+static void
+count_putchar(char ch)
+{
+	out_bytes++;
+}
+
+static void
+format(long *bytes, char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	lp_Print(count_output, bytes, fmt, ap);
+	va_end(ap);
+}
+
+static long
+bench_format(long n, const void *arg)
+{
+	const struct print_case *c = arg;
+	long bytes = 0;
+	long i;
+
+	for (i = 0; i < n; i++) {
+		bytes = 0;
+		if (c->str)
+			format(&bytes, c->fmt, c->str);
+		else
+			format(&bytes, c->fmt, c->num);
+	}
+	return bytes;
+}
+
+static long
+bench_quad(long n, const void *arg)
+{
+	long bytes = 0;
+	long i;
+
+	for (i = 0; i < n; i++) {
+		bytes = 0;
+		format(&bytes, "%llu", 18446744073709551615ULL - i);
+	}
+	return bytes;
+}
+
+static long
+bench_printf(long n, const void *arg)
+{
+	void (*saved)(char) = host_putchar;
+	long i;
+
+	host_putchar = count_putchar;
+	for (i = 0; i < n; i++) {
+		out_bytes = 0;
+		_printf("env %08x: status %d, runs %d\n", 0x1001, 1, (int)i);
+	}
+	host_putchar = saved;
+	return out_bytes;
+}
+
+/* The same through the TX ring, drained every 64 lines like an idle cpu. */
+static long
+bench_printf_async(long n, const void *arg)
+{
+	void (*saved)(char) = host_putchar;
+	long i;
+
+	host_putchar = count_putchar;
+	out_bytes = 0;
+	cons_tx_start();
+	for (i = 0; i < n; i++) {
+		_printf("env %08x: status %d, runs %d\n", 0x1001, 1, (int)i);
+		if ((i & 63) == 63)
+			cons_tx_drain();
+	}
+	cons_tx_sync();
+	host_putchar = saved;
+	return out_bytes / n;
+}
+
+static long
+bench_snprintf(long n, const void *arg)
+{
+	char buf[64];
+	int len = 0;
+	long i;
+
+	for (i = 0; i < n; i++) {
+		len = _snprintf(buf, sizeof(buf), "env %08x: status %d, runs %d\n",
+				0x1001, 1, (int)i);
+		bench_sink += buf[0];
+	}
+	return len;
+}
+
+static const struct print_case c_literal = { "no conversions at all" };
+static const struct print_case c_d = { "%d", 123456789 };
+static const struct print_case c_neg = { "%d", -123456789 };
+static const struct print_case c_x = { "%x", 0xdeadbeef };
+static const struct print_case c_08x = { "%08x", 0xbeef };
+static const struct print_case c_ld = { "%ld", 2147483647 };
+static const struct print_case c_c = { "%c", 'x' };
+static const struct print_case c_s = { "%s", 0, "hello, world" };
+static const struct print_case c_20s = { "%20s", 0, "hello" };
+static const struct print_case c_m20s = { "%-20s", 0, "hello" };
+static const struct print_case c_200s = { "%200s", 0, "hello" };
+static const struct print_case c_0200d = { "%0200d", -42 };
+static const struct print_case c_b = { "%b", 0xdeadbeef };
+static const struct print_case c_o = { "%o", 0xdeadbeef };
+static const struct print_case c_u = { "%u", 0xdeadbeef };
+static const struct print_case c_prec = { "%.10d", 42 };
+static const struct print_case c_alt = { "%#x", 0xbeef };
+
+const struct bench print_benches[] = {
+	{ "lp_Print/literal", bench_format, &c_literal },
+	{ "lp_Print/%d", bench_format, &c_d },
+	{ "lp_Print/%d-negative", bench_format, &c_neg },
+	{ "lp_Print/%x", bench_format, &c_x },
+	{ "lp_Print/%08x", bench_format, &c_08x },
+	{ "lp_Print/%ld", bench_format, &c_ld },
+	{ "lp_Print/%c", bench_format, &c_c },
+	{ "lp_Print/%s", bench_format, &c_s },
+	{ "lp_Print/%20s", bench_format, &c_20s },
+	{ "lp_Print/%-20s", bench_format, &c_m20s },
+	{ "lp_Print/%200s", bench_format, &c_200s },
+	{ "lp_Print/%0200d", bench_format, &c_0200d },
+	{ "printf/console", bench_printf, NULL },
+	{ "printf/console-async", bench_printf_async, NULL },
+	{ "printf/snprintf", bench_snprintf, NULL },
+	{ "lp_Print/%b", bench_format, &c_b },
+	{ "lp_Print/%o", bench_format, &c_o },
+	{ "lp_Print/%u", bench_format, &c_u },
+	{ "lp_Print/%.10d", bench_format, &c_prec },
+	{ "lp_Print/%#x", bench_format, &c_alt },
+	{ "lp_Print/%llu", bench_quad, NULL },
+	{ NULL },
+};
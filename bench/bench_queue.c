@@ -0,0 +1,183 @@
+/*
+ * queue.h and lfqueue.h benchmarks: insert/remove pairs on each list
+ * flavour.
+ */
+
+#include <queue.h>
+#include <lfqueue.h>
+#include "bench.h"
+
+#define NELEM	64
+
+struct elem {
+	SLIST_ENTRY(elem) sl_link;
+	STAILQ_ENTRY(elem) st_link;
+	LFSTACK_ENTRY(elem) lfs_link;
+	LFQUEUE_ENTRY(elem) lfq_link;
+	LIST_ENTRY(elem) l_link;
+	TAILQ_ENTRY(elem) t_link;
+	CIRCLEQ_ENTRY(elem) c_link;
+	long val;
+};
+
+SLIST_HEAD(elem_slist, elem);
+STAILQ_HEAD(elem_stailq, elem);
+LFSTACK_HEAD(elem_lfstack, elem);
+LFQUEUE_HEAD(elem_lfqueue, elem);
+LIST_HEAD(elem_list, elem);
+TAILQ_HEAD(elem_tailq, elem);
+CIRCLEQ_HEAD(elem_circleq, elem);
+
+static struct elem pool[NELEM];
+
+/* Push at the head, pop the same element: the free list pattern. */
+static long
+bench_slist(long n, const void *arg)
+{
+	struct elem_slist head;
+	struct elem *e;
+	long i;
+
+	SLIST_INIT(&head);
+	for (i = 0; i < NELEM; i++)
+		SLIST_INSERT_HEAD(&head, &pool[i], sl_link);
+
+	for (i = 0; i < n; i++) {
+		e = SLIST_FIRST(&head);
+		SLIST_REMOVE_HEAD(&head, sl_link);
+		SLIST_INSERT_HEAD(&head, e, sl_link);
+	}
+	bench_sink += SLIST_FIRST(&head)->val;
+	return sizeof(pool[0].sl_link);
+}
+
+static long
+bench_lfstack(long n, const void *arg)
+{
+	struct elem_lfstack head;
+	struct elem *e;
+	long i;
+
+	LFSTACK_INIT(&head);
+	for (i = 0; i < NELEM; i++)
+		LFSTACK_PUSH(&head, &pool[i], lfs_link);
+
+	for (i = 0; i < n; i++) {
+		e = LFSTACK_POP(&head, elem, lfs_link);
+		LFSTACK_PUSH(&head, e, lfs_link);
+	}
+	bench_sink += head.lsh_first->val;
+	return sizeof(pool[0].lfs_link);
+}
+
+static long
+bench_list(long n, const void *arg)
+{
+	struct elem_list head;
+	struct elem *e;
+	long i;
+
+	LIST_INIT(&head);
+	for (i = 0; i < NELEM; i++)
+		LIST_INSERT_HEAD(&head, &pool[i], l_link);
+
+	for (i = 0; i < n; i++) {
+		e = LIST_FIRST(&head);
+		LIST_REMOVE(e, l_link);
+		LIST_INSERT_HEAD(&head, e, l_link);
+	}
+	bench_sink += LIST_FIRST(&head)->val;
+	return sizeof(pool[0].l_link);
+}
+
+/* Rotate the queue: remove at the head, append at the tail. */
+static long
+bench_tailq(long n, const void *arg)
+{
+	struct elem_tailq head;
+	struct elem *e;
+	long i;
+
+	TAILQ_INIT(&head);
+	for (i = 0; i < NELEM; i++)
+		TAILQ_INSERT_TAIL(&head, &pool[i], t_link);
+
+	for (i = 0; i < n; i++) {
+		e = head.tqh_first;
+		TAILQ_REMOVE(&head, e, t_link);
+		TAILQ_INSERT_TAIL(&head, e, t_link);
+	}
+	bench_sink += head.tqh_first->val;
+	return sizeof(pool[0].t_link);
+}
+
+static long
+bench_stailq(long n, const void *arg)
+{
+	struct elem_stailq head;
+	struct elem *e;
+	long i;
+
+	STAILQ_INIT(&head);
+	for (i = 0; i < NELEM; i++)
+		STAILQ_INSERT_TAIL(&head, &pool[i], st_link);
+
+	for (i = 0; i < n; i++) {
+		e = STAILQ_FIRST(&head);
+		STAILQ_REMOVE_HEAD(&head, st_link);
+		STAILQ_INSERT_TAIL(&head, e, st_link);
+	}
+	bench_sink += STAILQ_LAST(&head, elem, st_link)->val;
+	return sizeof(pool[0].st_link);
+}
+
+static long
+bench_lfqueue(long n, const void *arg)
+{
+	struct elem_lfqueue head;
+	struct elem *e;
+	long i;
+
+	LFQUEUE_INIT(&head);
+	for (i = 0; i < NELEM; i++)
+		LFQUEUE_ENQUEUE(&head, &pool[i], lfq_link);
+
+	for (i = 0; i < n; i++) {
+		LFQUEUE_DEQUEUE(&head, e, lfq_link);
+		LFQUEUE_ENQUEUE(&head, e, lfq_link);
+	}
+	LFQUEUE_DEQUEUE(&head, e, lfq_link);
+	bench_sink += e->val;
+	return sizeof(pool[0].lfq_link);
+}
+
+static long
+bench_circleq(long n, const void *arg)
+{
+	struct elem_circleq head;
+	struct elem *e;
+	long i;
+
+	CIRCLEQ_INIT(&head);
+	for (i = 0; i < NELEM; i++)
+		CIRCLEQ_INSERT_TAIL(&head, &pool[i], c_link);
+
+	for (i = 0; i < n; i++) {
+		e = head.cqh_first;
+		CIRCLEQ_REMOVE(&head, e, c_link);
+		CIRCLEQ_INSERT_TAIL(&head, e, c_link);
+	}
+	bench_sink += head.cqh_first->val;
+	return sizeof(pool[0].c_link);
+}
+
+const struct bench queue_benches[] = {
+	{ "queue/SLIST", bench_slist, NULL },
+	{ "queue/STAILQ", bench_stailq, NULL },
+	{ "queue/LFSTACK", bench_lfstack, NULL },
+	{ "queue/LFQUEUE", bench_lfqueue, NULL },
+	{ "queue/LIST", bench_list, NULL },
+	{ "queue/TAILQ", bench_tailq, NULL },
+	{ "queue/CIRCLEQ", bench_circleq, NULL },
+	{ NULL },
+};
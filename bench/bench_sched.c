@@ -0,0 +1,93 @@
+/*
+ * Run queue benchmarks: the local enqueue/pick round trip, draining
+ * a remote queue through work stealing, and sleeping on a channel.
+ */
+
+#include <env.h>
+#include <sched.h>
+#include <smp.h>
+#include "bench.h"
+
+#define NENVS	64
+
+static struct Env pool[NENVS];
+
+static void
+reset(int cpus)
+{
+	int i;
+
+	ncpu = cpus;
+	sched_init();
+	for (i = 0; i < NENVS; i++) {
+		pool[i].env_cpu = -1;
+		pool[i].env_sched_link.tqe_prev = NULL;
+	}
+}
+
+/* Requeue and pick again, what a cpu does on every switch. */
+static long
+bench_yield(long n, const void *arg)
+{
+	struct Env *e;
+	long i;
+
+	reset(1);
+	for (i = 0; i < NENVS; i++)
+		sched_enqueue(&pool[i]);
+
+	for (i = 0; i < n; i++) {
+		e = sched_pick();
+		sched_enqueue(e);
+	}
+	bench_sink += e->env_cpu;
+	return sizeof(e->env_sched_link);
+}
+
+/* cpu 0 (the only cpu the host has) drains envs queued on cpu 1. */
+static long
+bench_steal(long n, const void *arg)
+{
+	struct Env *e;
+	long i = 0;
+	int j;
+
+	reset(2);
+	while (i < n) {
+		for (j = 0; j < NENVS; j++) {
+			pool[j].env_cpu = 1;
+			sched_enqueue(&pool[j]);
+		}
+		while ((e = sched_pick()) != NULL)
+			i++;
+	}
+	reset(1);
+	return sizeof(pool[0].env_sched_link);
+}
+
+/* An env sleeps on a channel and is woken back onto the run queue. */
+static long
+bench_sleep(long n, const void *arg)
+{
+	static int chan;
+	struct Env *e;
+	long i;
+
+	reset(1);
+	for (i = 0; i < n; i++) {
+		curenv = &pool[i % NENVS];
+		sched_sleep(&chan);
+		sched_wakeup(&chan);
+		e = sched_pick();
+	}
+	bench_sink += e->env_status;
+	curenv = NULL;
+	return sizeof(e->env_wchan);
+}
+
+const struct bench sched_benches[] = {
+	{ "sched/yield", bench_yield, NULL },
+	{ "sched/steal", bench_steal, NULL },
+	{ "sched/sleep-wakeup", bench_sleep, NULL },
+	{ NULL },
+};
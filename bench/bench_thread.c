@@ -0,0 +1,127 @@
+/*
+ * Thread benchmarks: creating and dropping a thread in a leader's space
+ * against taking a full env, and switching between two threads of one
+ * space against two envs of their own.  The host has no TLB, so a
+ * switch only shows what thread_loadspace() saves: bytes/op is the
+ * cpu state it rewrites.
+ */
+
+#include <thread.h>
+#include <pmap.h>
+#include <sched.h>
+#include <smp.h>
+#include "test.h"
+#include "bench.h"
+
+static struct Env *leader;
+
+static int
+setup(void)
+{
+	page_init();
+	env_init();
+	sched_init();
+	if ((leader = host_env_new()) == NULL)
+		return -1;
+	leader->env_asid = 5;
+	return 0;
+}
+
+/* A thread started and dropped again, stack slot and all. */
+static long
+bench_create(long n, const void *arg)
+{
+	struct Env *t;
+	long i;
+
+	if (setup() < 0)
+		return 0;
+	for (i = 0; i < n; i++) {
+		if (thread_create(&t, leader, 0x00400100, i) < 0)
+			return 0;
+		sched_dequeue(t);
+		thread_put_space(t);
+		env_put(t);
+	}
+	return BY2PG;
+}
+
+/*
+ * What env_alloc() adds to env_take() for a space of its own: a zeroed
+ * directory with the kernel half of boot_pgdir copied in, and a page
+ * table and a page for the stack.
+ */
+static long
+bench_create_env(long n, const void *arg)
+{
+	static u_char kern[BY2PG];
+	struct Page *pd, *pt, *stk;
+	struct Env *e;
+	long i;
+
+	if (setup() < 0)
+		return 0;
+	for (i = 0; i < n; i++) {
+		if (env_take(&e, leader->env_id) < 0 || page_alloc(&pd) < 0 ||
+		    page_alloc(&pt) < 0 || page_alloc(&stk) < 0)
+			return 0;
+		bcopy(kern + BY2PG / 2, (void *)(page2kva(pd) + BY2PG / 2),
+		      BY2PG / 2);
+		e->env_pgdir = (Pde *)page2kva(pd);
+		e->env_cr3 = page2pa(pd);
+		page_free(stk);
+		page_free(pt);
+		page_free(pd);
+		env_put(e);
+	}
+	return 3 * BY2PG;
+}
+
+static long
+switch_between(long n, struct Env *a, struct Env *b)
+{
+	struct cpu *c = mycpu();
+	long i, loads = 0;
+
+	c->cpu_cr3 = 0;
+	for (i = 0; i < n; i++)
+		loads += thread_loadspace(c, i & 1 ? b : a);
+	bench_sink += loads;
+	return loads / n * sizeof(c->cpu_cr3);
+}
+
+static long
+bench_switch(long n, const void *arg)
+{
+	struct Env *t;
+	long r;
+
+	if (setup() < 0 || thread_create(&t, leader, 0x00400100, 0) < 0)
+		return 0;
+	r = switch_between(n, leader, t);
+	sched_dequeue(t);
+	thread_put_space(t);
+	env_put(t);
+	return r;
+}
+
+static long
+bench_switch_env(long n, const void *arg)
+{
+	struct Env *e;
+	long r;
+
+	if (setup() < 0 || (e = host_env_new()) == NULL)
+		return 0;
+	r = switch_between(n, leader, e);
+	env_put(e);
+	return r;
+}
+
+const struct bench thread_benches[] = {
+	{ "thread/create", bench_create, NULL },
+	{ "thread/create-env", bench_create_env, NULL },
+	{ "thread/switch", bench_switch, NULL },
+	{ "thread/switch-env", bench_switch_env, NULL },
+	{ NULL },
+};
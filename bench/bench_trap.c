@@ -0,0 +1,87 @@
+/*
+ * Page fault upcall benchmarks: the kernel's half of a round trip, from
+ * the faulting Trapframe to the return into the user handler, and the
+ * check every later exception from the env pays.  The user half is 61
+ * instructions in user/pgfault.S plus the C handler.  Copying the whole
+ * Trapframe out instead is there for comparison.
+ */
+
+#include <env.h>
+#include <pgfault.h>
+#include <mmu.h>
+#include "test.h"
+#include "bench.h"
+
+static struct Env env;
+static struct Trapframe tf;
+
+static int
+setup(void)
+{
+	static u_long xstack;
+
+	if (xstack == 0 && (xstack = (u_long)host_usermem(BY2PG)) == 0)
+		return -1;
+	env.env_xstacktop = xstack + BY2PG;
+	env.env_pgfault_handler = 0x00400100;
+	return 0;
+}
+
+/* A fault on the normal stack, upcalled and returned from. */
+static long
+bench_upcall(long n, const void *arg)
+{
+	long i;
+
+	if (setup() < 0)
+		return 0;
+	for (i = 0; i < n; i++) {
+		tf.regs[29] = 0x7f3fe000 - 64;
+		tf.cp0_epc = 0x00400400 + (i & 0xff) * 4;
+		tf.cp0_badvaddr = 0x10000000 + (i & 0xff) * BY2PG;
+		if (pgfault_upcall(&env, &tf) < 0)
+			return 0;
+		bench_sink += tf.regs[29];
+	}
+	return sizeof(struct UFault);
+}
+
+/* The EPC check on an exception that did not hit the resume sequence. */
+static long
+bench_fixup(long n, const void *arg)
+{
+	long i;
+
+	setup();
+	for (i = 0; i < n; i++) {
+		tf.cp0_epc = 0x00400400 + (i & 0xff) * 4;
+		pgfault_fixup(&env, &tf);
+		bench_sink += tf.cp0_epc;
+	}
+	return 0;
+}
+
+/* Handing over the whole Trapframe instead. */
+static long
+bench_tfcopy(long n, const void *arg)
+{
+	long i;
+
+	if (setup() < 0)
+		return 0;
+	for (i = 0; i < n; i++) {
+		tf.cp0_epc = 0x00400400 + (i & 0xff) * 4;
+		__builtin_memcpy((void *)(env.env_xstacktop - sizeof(tf)), &tf, sizeof(tf));
+		tf.regs[29] = env.env_xstacktop - sizeof(tf);
+		tf.cp0_epc = env.env_pgfault_handler;
+		bench_sink += tf.regs[29];
+	}
+	return sizeof(struct Trapframe);
+}
+
+const struct bench trap_benches[] = {
+	{ "trap/pgfault-upcall",	bench_upcall,	NULL },
+	{ "trap/pgfault-fixup",		bench_fixup,	NULL },
+	{ "trap/pgfault-tfcopy",	bench_tfcopy,	NULL },
+	{ NULL }
+};
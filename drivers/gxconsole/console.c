@@ -9,8 +9,10 @@
 #include "dev_cons.h"
 
 /*  Note: The ugly cast to a signed int (32-bit) causes the address to be
-	sign-extended correctly on MIPS when compiled in 64-bit mode  */
-#define	PHYSADDR_OFFSET		((signed int)0x80000000)
+	sign-extended correctly on MIPS when compiled in 64-bit mode.
+	Devices are reached through kseg1 so that the accesses bypass the
+	cache even when kseg0 is cached (see include/cache.h).  */
+#define	PHYSADDR_OFFSET		((signed int)0xa0000000)
 
 
 #define	PUTCHAR_ADDRESS		(PHYSADDR_OFFSET +		\
@@ -25,6 +27,13 @@ void printcharc(char ch)
 }
 
 
+/*  Returns the next input char, or 0 if there is none.  */
+int scancharc(void)
+{
+	return *((volatile unsigned char *) PUTCHAR_ADDRESS);
+}
+
+
 void halt(void)
 {
 	*((volatile unsigned char *) HALT_ADDRESS) = 0;
@@ -15,5 +15,8 @@
 #define	    DEV_CONS_PUTGETCHAR		    0x0000
 #define	    DEV_CONS_HALT		    0x0010
 
+/*  The cons device raises IRQ 2 (Cause.IP2) while input is pending.  */
+#define	DEV_CONS_IRQ			2
+
 
 #endif	/*  TESTMACHINE_CONS_H  */
@@ -0,0 +1,82 @@
+/*
+ *  Access to GXemul's "disk" device.
+ *
+ *  The device moves one 512-byte sector per operation between the disk
+ *  image and its buffer window: set the disk id and the byte offset,
+ *  start the operation, and read the status back (0 means it failed).
+ *  disk_xfer() runs any number of contiguous sectors back to back, so
+ *  the request queue in lib/disk.c pays for a batch, not a sector.
+ */
+
+#include "dev_disk.h"
+
+/*  Uncached kseg1, see drivers/gxconsole/console.c  */
+#define	PHYSADDR_OFFSET		((signed int)0xa0000000)
+
+#define	DISK_REG(r)	(*(volatile unsigned int *)			\
+				(PHYSADDR_OFFSET + DEV_DISK_ADDRESS + (r)))
+#define	DISK_BUFFER	((volatile unsigned int *)			\
+				(PHYSADDR_OFFSET + DEV_DISK_ADDRESS + DEV_DISK_BUFFER))
+
+#define	SECT_WORDS	(DEV_DISK_BUFFER_LEN / 4)
+
+
+static void disk_copyin(unsigned int *dst)
+{
+	volatile unsigned int *src = DISK_BUFFER;
+	int i;
+
+	for (i = 0; i < SECT_WORDS; i += 4) {
+		dst[i] = src[i];
+		dst[i + 1] = src[i + 1];
+		dst[i + 2] = src[i + 2];
+		dst[i + 3] = src[i + 3];
+	}
+}
+
+
+static void disk_copyout(const unsigned int *src)
+{
+	volatile unsigned int *dst = DISK_BUFFER;
+	int i;
+
+	for (i = 0; i < SECT_WORDS; i += 4) {
+		dst[i] = src[i];
+		dst[i + 1] = src[i + 1];
+		dst[i + 2] = src[i + 2];
+		dst[i + 3] = src[i + 3];
+	}
+}
+
+
+/*
+ *  Read (write != 0: write) nsecs sectors starting at secno of disk
+ *  diskno to or from buf, which must be word aligned.  Returns 0, or -1
+ *  as soon as the device reports a failure.
+ */
+int disk_xfer(int diskno, unsigned int secno, void *buf,
+	      unsigned int nsecs, int write)
+{
+	unsigned int *p = buf;
+	int op = write ? DEV_DISK_OPERATION_WRITE : DEV_DISK_OPERATION_READ;
+
+	DISK_REG(DEV_DISK_ID) = diskno;
+	DISK_REG(DEV_DISK_OFFSET_HIGH32) = secno >> 23;
+
+	for (; nsecs > 0; nsecs--) {
+		DISK_REG(DEV_DISK_OFFSET) = secno * DEV_DISK_BUFFER_LEN;
+		if (write)
+			disk_copyout(p);
+		DISK_REG(DEV_DISK_START_OPERATION) = op;
+		if (DISK_REG(DEV_DISK_STATUS) == 0)
+			return -1;
+		if (!write)
+			disk_copyin(p);
+
+		p += SECT_WORDS;
+		// the high word of the offset only moves every 4GB
+		if ((++secno & 0x7fffff) == 0)
+			DISK_REG(DEV_DISK_OFFSET_HIGH32) = secno >> 23;
+	}
+	return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ *  Access to GXemul's "mp" device: which cpu am I, how many cpus are
+ *  there, and starting a stopped cpu at a given pc and stack.
+ *
+ *  Only cpu 0 runs after reset; the others stay stopped until
+ *  mp_startcpu() is called for them.
+ */
+
+#include "dev_mp.h"
+
+/*  Uncached kseg1, see drivers/gxconsole/console.c  */
+#define	PHYSADDR_OFFSET		((signed int)0xa0000000)
+
+#define	MP_REG(r)	(*(volatile unsigned int *)			\
+				(PHYSADDR_OFFSET + DEV_MP_ADDRESS + (r)))
+
+
+int mp_whoami(void)
+{
+	return MP_REG(DEV_MP_WHOAMI);
+}
+
+
+int mp_ncpus(void)
+{
+	return MP_REG(DEV_MP_NCPUS);
+}
+
+
+void mp_startcpu(int cpu, unsigned long pc, unsigned long sp)
+{
+	MP_REG(DEV_MP_STARTUPADDR) = pc;
+	MP_REG(DEV_MP_STARTUPSTACK) = sp;
+	MP_REG(DEV_MP_STARTUPCPU) = cpu;
+}
@@ -1,28 +1,163 @@
 //
 // Created by tonny on 17-3-10.
 //
+// Conformance and throughput test of the kernel printf against the host
+// C library: every case is formatted by both _snprintf() and snprintf()
+// and must come out the same.  The kernel-only conversions (%b, %t, %T,
+// %p of NULL) are checked against fixed strings instead.
+//
+// dummy [-q]: -q skips the throughput table.
+//
 #include <printf.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static int failed, checked;
+
+static void
+compare(const char *where, const char *fmt, const char *got, int gotlen,
+        const char *want, int wantlen)
+{
+    checked++;
+    if (gotlen == wantlen && strcmp(got, want) == 0)
+        return;
+    failed++;
+    printf("FAIL %s: \"%s\": got \"%s\" (%d), want \"%s\" (%d)\n",
+           where, fmt, got, gotlen, want, wantlen);
+}
+
+#define CHECK(fmt, ...) do {                                            \
+        char got[256], want[256];                                       \
+        int gotlen = _snprintf(got, sizeof(got), fmt, __VA_ARGS__);     \
+        int wantlen = snprintf(want, sizeof(want), fmt, __VA_ARGS__);   \
+        compare("libc", fmt, got, gotlen, want, wantlen);               \
+    } while (0)
 
-int main() {
-    printf("%10.6d", 3);
-    _printf("Strings:\n");
+#define EXPECT(want, fmt, ...) do {                                     \
+        char got[256];                                                  \
+        int gotlen = _snprintf(got, sizeof(got), fmt, __VA_ARGS__);     \
+        compare("kern", fmt, got, gotlen, want, strlen(want));          \
+    } while (0)
 
+static void
+conformance(void)
+{
     const char *s = "Hello";
-    _printf("\t[%10s]\n\t[%-10s]\n\t[%*s]\n\t[%-10.*s]\n\t[%-*.*s]\n",
-            s, s, 10, s, 4, s, 10, 4, s);
+    int x;
+
+    // strings
+    CHECK("[%10s] [%-10s] [%*s]", s, s, 10, s);
+    CHECK("[%-10.*s] [%-*.*s] [%.2s]", 4, s, 10, 4, s, s);
+    CHECK("[%.0s] [%.10s] [%*s]", s, s, -8, s);
+    CHECK("[%200s]", s);
+
+    // characters
+    CHECK("%c %% [%5c] [%-5c]", 65, 'x', 'x');
+    CHECK("'%*c' '%*c'", 5, 'x', -5, 'x');
+
+    // decimal
+    CHECK("%i %d %.6i %i %.0i %+i %u", 1, 2, 3, 0, 0, 4, -1);
+    CHECK("%10.6d|%-10.6d|%010d|%-010d", 3, -3, -3, 3);
+    CHECK("% d|% d|%+d|%+ d|% 05d", 7, -7, 0, 7, 7);
+    CHECK("%d %d %u", 2147483647, -2147483647 - 1, 4294967295u);
+    CHECK("%08.3d|%.0d|%5.0d|%-5.0d|", 42, 0, 0, 0);
+    CHECK("%hd %hu %hhd %hhu", 70000, 70000, 200, 300);
+    CHECK("%ld %lu %lx", -1L, 123456789UL, 0xdeadbeefUL);
+
+    // 64-bit
+    CHECK("%lld %llu", -9223372036854775807LL - 1, 18446744073709551615ULL);
+    CHECK("%llx %llX %llo", 0x123456789abcdefULL, 0xfedcba987654321ULL,
+          01234567012345670123ULL);
+    CHECK("%qd %qu %-25lld|%025llu", 1LL << 40, 1ULL << 63, -1LL,
+          10000000000ULL);
+
+    // hex and octal
+    CHECK("%x %x %X %#x %#X", 5, 10, 10, 6, 255);
+    CHECK("%x %08x %-8x| %#08x %#.8x", -1, 0xbeef, 0xbeef, 0xbeef, 0xbeef);
+    CHECK("%#x %#.0x %#o %#.0o %#5o", 0, 0, 0, 0, 8);
+    CHECK("%o %#o %#o %.4o %#.4o", 10, 10, 4, 8, 8);
+
+    // pointers
+    CHECK("%p %20p %-20p|", (void *)&x, (void *)&x, (void *)&x);
+
+    // odds and ends
+    CHECK("%d%%%d no conversion at the end %s", 1, 2, "");
+    CHECK("%-+5d|%+-5d|%-05d", 3, 3, 3);
+
+    // kernel-only conversions
+    EXPECT("101 11111111 00000101", "%b %b %08b", 5, 255, 5);
+    EXPECT("1111111111111111111111111111111111111111111111111111111111111111",
+           "%llb", 18446744073709551615ULL);
+    EXPECT("1000000000000000000000000000000000000000000000000000000000000000|",
+           "%-5llb|", 1ULL << 63);
+    EXPECT("x X 10 1x", "%t %T %t %t", 10, 10, 11, 21);
+    EXPECT("0x0", "%p", (void *)0);
+    EXPECT("(null)", "%s", (char *)0);
+
+    // a NUL from %c is a char like any other, not the end of output
+    {
+        char got[8];
+        int gotlen = _snprintf(got, sizeof(got), "a%cb", 0);
+
+        checked++;
+        if (gotlen != 3 || memcmp(got, "a\0b", 4) != 0) {
+            failed++;
+            printf("FAIL kern: \"a%%cb\" with NUL: got %d\n", gotlen);
+        }
+    }
+}
+
+static double
+elapsed_ns(struct timespec *t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (t1.tv_sec - t0->tv_sec) * 1e9 + (t1.tv_nsec - t0->tv_nsec);
+}
+
+#define THROUGHPUT(fmt, ...) do {                                       \
+        char buf[256];                                                  \
+        struct timespec t0;                                             \
+        double kern, libc;                                              \
+        long i;                                                         \
+        clock_gettime(CLOCK_MONOTONIC, &t0);                            \
+        for (i = 0; i < n; i++)                                         \
+            _snprintf(buf, sizeof(buf), fmt, __VA_ARGS__);              \
+        kern = elapsed_ns(&t0) / n;                                     \
+        clock_gettime(CLOCK_MONOTONIC, &t0);                            \
+        for (i = 0; i < n; i++)                                         \
+            snprintf(buf, sizeof(buf), fmt, __VA_ARGS__);               \
+        libc = elapsed_ns(&t0) / n;                                     \
+        printf("%-32s %8.1f %8.1f\n", fmt, kern, libc);                 \
+    } while (0)
+
+static void
+throughput(void)
+{
+    const long n = 200000;
 
-    _printf("Characters:\t%c %%\n", 65);
+    printf("%-32s %8s %8s\n", "ns/op", "kern", "libc");
+    THROUGHPUT("env %08x: status %d, runs %d", 0x1001, 1, 42);
+    THROUGHPUT("%s", "hello, world");
+    THROUGHPUT("%-20s|%20s", "left", "right");
+    THROUGHPUT("%d", -123456789);
+    THROUGHPUT("%lu", 4294967295UL);
+    THROUGHPUT("%llu", 18446744073709551615ULL);
+    THROUGHPUT("%#010x", 0xbeef);
+    THROUGHPUT("%.10d", 42);
+    THROUGHPUT("%p", (void *)&n);
+}
 
-    _printf("Integers\n");
-    _printf("Decimal:\t%i %d %.6i %i %.0i %+i %u\n", 1, 2, 3, 0, 0, 4, -1);
-    printf("Decimal:\t%i %d %.6i %i %.0i %+i %u\n", 1, 2, 3, 0, 0, 4, -1);
-    _printf("Hexadecimal:\t%x %x %X %#x\n", 5, 10, 10, 6);
-    _printf("Octal:\t%o %#o %#o\n", 10, 10, 4);
+int
+main(int argc, char **argv)
+{
+    conformance();
+    printf("printf: %d of %d cases conform\n", checked - failed, checked);
 
-    _printf("Variable width control:\n");
-    _printf("right-justified variable width: '%*c'\n", 5, 'x');
-    _printf("left-justified variable width : '%*c'\n", -5, 'x');
+    if (!(argc > 1 && strcmp(argv[1], "-q") == 0))
+        throughput();
 
-    return 0;
-}
\ No newline at end of file
+    return failed != 0;
+}
@@ -8,3 +8,8 @@ CROSS_COMPILE := /OSLAB/compiler/usr/bin/mips_4KC-
 CC			  := $(CROSS_COMPILE)gcc
 CFLAGS		  := -O -G 0 -mno-abicalls -fno-builtin -Wa,-xgot -Wall -fPIC
 LD			  := $(CROSS_COMPILE)ld
+
+# make KSEG0_CACHED=1 runs the kernel from cached kseg0, see include/cache.h
+ifeq ($(KSEG0_CACHED),1)
+CFLAGS		  += -DCONFIG_KSEG0_CACHED
+endif
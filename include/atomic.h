@@ -0,0 +1,156 @@
+#ifndef _ATOMIC_H_
+#define _ATOMIC_H_
+
+#include "types.h"
+
+/*
+ * Word sized atomic operations built on LL/SC (MIPS II and later; the
+ * kernel is assembled with .set mips2).  Every operation is a full
+ * barrier.  The x86_64 versions let the host build use the same code.
+ */
+
+#ifdef __x86_64__
+
+#define atomic_add(p, v)		__sync_add_and_fetch((p), (v))
+#define atomic_cmpxchg(p, old, new)	__sync_bool_compare_and_swap((p), (old), (new))
+#define atomic_cmpxchg_ptr(p, old, new)	__sync_bool_compare_and_swap((p), (old), (new))
+#define atomic_swap_ptr(p, v)		__atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#define mb()				__sync_synchronize()
+
+/*
+ * Compare-and-swap is open to ABA here, unlike LL/SC.  The host build
+ * only runs single threaded tests and benchmarks.
+ */
+static inline void *
+atomic_pop_ptr(void * volatile *head, u_long off)
+{
+	void *old;
+
+	do {
+		old = *head;
+	} while (old && !__sync_bool_compare_and_swap(head, old,
+				*(void **)((char *)old + off)));
+	return old;
+}
+
+#else
+
+#define mb()	asm volatile(".set push\n\t.set mips2\n\tsync\n\t.set pop" ::: "memory")
+
+/* Add v to *p, return the new value. */
+static inline u_int
+atomic_add(volatile u_int *p, int v)
+{
+	u_int tmp, ret;
+
+	asm volatile(
+		".set	push\n\t"
+		".set	mips2\n\t"
+		".set	noreorder\n"
+		"1:	ll	%0, %2\n\t"
+		"addu	%1, %0, %3\n\t"
+		"move	%0, %1\n\t"
+		"sc	%0, %2\n\t"
+		"beqz	%0, 1b\n\t"
+		"nop\n\t"
+		"sync\n\t"
+		".set	pop"
+		: "=&r"(tmp), "=&r"(ret), "+m"(*p)
+		: "r"(v)
+		: "memory");
+	return ret;
+}
+
+/* If *p == old, store new and return 1; otherwise return 0. */
+static inline int
+atomic_cmpxchg(volatile u_int *p, u_int old, u_int new)
+{
+	u_int ok;
+
+	asm volatile(
+		".set	push\n\t"
+		".set	mips2\n\t"
+		".set	noreorder\n"
+		"1:	ll	%0, %1\n\t"
+		"bne	%0, %2, 2f\n\t"
+		"li	%0, 0\n\t"
+		"move	%0, %3\n\t"
+		"sc	%0, %1\n\t"
+		"beqz	%0, 1b\n\t"
+		"nop\n\t"
+		"sync\n"
+		"2:\n\t"
+		".set	pop"
+		: "=&r"(ok), "+m"(*p)
+		: "r"(old), "r"(new)
+		: "memory");
+	return ok;
+}
+
+#define atomic_cmpxchg_ptr(p, old, new)					\
+	atomic_cmpxchg((volatile u_int *)(p), (u_int)(old), (u_int)(new))
+
+/* Store v in *p, return the old value. */
+static inline void *
+atomic_swap_ptr(void * volatile *p, void *v)
+{
+	void *old;
+	u_int tmp;
+
+	asm volatile(
+		".set	push\n\t"
+		".set	mips2\n\t"
+		".set	noreorder\n"
+		"1:	ll	%0, %2\n\t"
+		"move	%1, %3\n\t"
+		"sc	%1, %2\n\t"
+		"beqz	%1, 1b\n\t"
+		"nop\n\t"
+		"sync\n\t"
+		".set	pop"
+		: "=&r"(old), "=&r"(tmp), "+m"(*p)
+		: "r"(v)
+		: "memory");
+	return old;
+}
+
+/*
+ * Unlink the first element of an intrusive singly linked list: *head
+ * becomes the pointer stored off bytes into the old first element,
+ * which is returned (NULL if the list was empty).  LL/SC fails if *head
+ * changed in between, so unlike compare-and-swap this has no ABA
+ * problem even when elements are popped and pushed back concurrently.
+ * The ISA calls a load between LL and SC non-portable; the R4000
+ * family, the 4Kc and GXemul all allow it.
+ */
+static inline void *
+atomic_pop_ptr(void * volatile *head, u_long off)
+{
+	void *old;
+	u_int tmp;
+
+	asm volatile(
+		".set	push\n\t"
+		".set	mips2\n\t"
+		".set	noreorder\n"
+		"1:	ll	%0, %2\n\t"
+		"beqz	%0, 2f\n\t"
+		"addu	%1, %0, %3\n\t"
+		"lw	%1, 0(%1)\n\t"
+		"sc	%1, %2\n\t"
+		"beqz	%1, 1b\n\t"
+		"nop\n\t"
+		"sync\n"
+		"2:\n\t"
+		".set	pop"
+		: "=&r"(old), "=&r"(tmp), "+m"(*head)
+		: "r"(off)
+		: "memory");
+	return old;
+}
+
+#endif /* __x86_64__ */
+
+#define atomic_inc(p)	atomic_add((p), 1)
+
+#endif /* _ATOMIC_H_ */
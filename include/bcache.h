@@ -0,0 +1,78 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _BCACHE_H_
+#define _BCACHE_H_
+
+#include "types.h"
+#include "queue.h"
+#include "mmu.h"
+#include "disk.h"
+
+/*
+ * Buffer cache.
+ *
+ * NBUF block buffers, one page each from page_alloc(), found by
+ * (disk, block) through a hash table and recycled least recently used
+ * first.  bread() returns a buffer holding the block with a reference
+ * on it; brelse() drops the reference.  A caller that changed the data
+ * marks it with bdirty(): the block is written back later, by
+ * bcache_flush() or when the buffer is recycled, and bawrite() starts
+ * the write at once without waiting for it.
+ *
+ * bread() watches each disk for sequential access.  Once a reader has
+ * asked for consecutive blocks twice in a row, it queues asynchronous
+ * reads of the next blocks, doubling the window up to BC_RAMAX blocks,
+ * so a sequential reader mostly finds its blocks already there.  Those
+ * reads complete through the disk queue (disk.h): a buffer with I/O in
+ * flight is waited for when it is next looked up or recycled.
+ *
+ * The counters in bcache_stats say how well the cache fits the working
+ * set: a low hit rate or read-ahead blocks evicted unused call for a
+ * larger NBUF.
+ */
+
+#define BY2BLK		BY2PG
+#define BLK2SECT	(BY2BLK / SECT_SIZE)
+
+#define NBUF		64
+#define BC_NHASH	32		// power of two
+#define BC_RAMAX	8		// largest read-ahead window, in blocks
+#define BC_NDISK	2		// disks watched for sequential reads
+
+struct buf {
+	LIST_ENTRY(buf) b_hash;		// hash chain, while b_flags & B_VALID
+	TAILQ_ENTRY(buf) b_lru;		// least recently used first
+	int b_diskno;
+	u_int b_blockno;
+	u_int b_flags;
+	u_int b_ref;			// bread()s not yet brelse()d
+	u_char *b_data;			// BY2BLK bytes
+	struct disk_req b_req;		// in flight while b_flags & B_IO
+};
+
+#define B_VALID		0x01		// names a block; b_data holds it unless B_IO
+#define B_DIRTY		0x02		// b_data is newer than the disk
+#define B_IO		0x04		// b_req is queued or running
+#define B_RA		0x08		// read ahead, not yet asked for
+
+struct bcache_stats {
+	u_int bs_hits;			// bread()s that found the block
+	u_int bs_misses;		// bread()s that had to read it
+	u_int bs_ra_issued;		// blocks read ahead
+	u_int bs_ra_hits;		// ... and later asked for
+	u_int bs_ra_wasted;		// ... and recycled unused
+	u_int bs_writebacks;		// dirty blocks written
+	u_int bs_evictions;		// buffers recycled for another block
+};
+
+extern struct bcache_stats bcache_stats;
+
+int bcache_init(void);
+struct buf *bread(int diskno, u_int blockno);
+void brelse(struct buf *b);
+void bdirty(struct buf *b);
+void bawrite(struct buf *b);
+int bcache_flush(void);
+void bcache_dump(void);
+
+#endif // !_BCACHE_H_
@@ -0,0 +1,73 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+/*
+ * Primary cache maintenance for MIPS32 cores (4Kc and friends).
+ *
+ * The kernel normally runs with kseg0 uncached (Config.K0 = 2, see
+ * boot/start.S).  Building with KSEG0_CACHED=1 defines
+ * CONFIG_KSEG0_CACHED: _start then calls cache_init() while still
+ * uncached and switches kseg0 to cacheable noncoherent (K0 = 3).
+ * Cache geometry comes from CP0 Config1, so the cached mode needs a
+ * MIPS32 cpu; R3000 has neither Config1 nor the CACHE instruction.
+ *
+ * Whoever writes instructions through kseg0 (the binary loader, the
+ * page-mapping code handing a fresh code page to an env) must call
+ * icache_sync() on the range before it can be executed, and
+ * cache_flush_range() before a device or uncached alias reads memory
+ * written through the cache.  Both are cheap no-ops when uncached.
+ */
+
+#define CACHE_LINE		32	// 4Kc line size, a multiple of R3000's
+
+#define K0_UNCACHED		2
+#define K0_CACHABLE_NONCOHERENT	3
+
+/* CACHE instruction operations: bits 1:0 cache, bits 4:2 operation. */
+#define Index_Invalidate_I	0x00
+#define Index_Writeback_Inv_D	0x01
+#define Index_Store_Tag_I	0x08
+#define Index_Store_Tag_D	0x09
+#define Hit_Invalidate_I	0x10
+#define Hit_Writeback_Inv_D	0x15
+
+#ifndef __ASSEMBLER__
+
+#include "types.h"
+
+struct cache_info {
+	u_int ci_size;		// bytes, 0 if there is no cache
+	u_int ci_linesz;	// bytes per line
+	u_int ci_ways;
+};
+
+extern struct cache_info icache, dcache;
+
+/*
+ * Placement hints for tools/scse0_3.lds: code on the trap, TLB refill
+ * and scheduling paths goes to .text.hot, where it sits together; data
+ * written by several cpus starts on a line of its own.
+ */
+#define __text_hot		__attribute__((section(".text.hot")))
+#define __cacheline_aligned	__attribute__((aligned(CACHE_LINE),	\
+					section(".data.cacheline_aligned")))
+
+void cache_init(void);
+void cache_flush_range(u_long va, u_long len);
+void icache_sync(u_long va, u_long len);
+
+/* Overview:
+ *	Tell a MIPS32 cpu such as the 4Kc, which has Config1, from an
+ *	R3000, whose PRId has no company ID.
+ */
+static inline int
+cpu_is_4kc(void)
+{
+	u_int prid;
+
+	asm volatile("mfc0 %0, $15" : "=r"(prid));
+	return ((prid >> 16) & 0xff) != 0;
+}
+
+#endif /* !__ASSEMBLER__ */
+#endif /* _CACHE_H_ */
@@ -0,0 +1,59 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _CONS_H_
+#define _CONS_H_
+
+/*
+ * Console input.
+ *
+ * The GXemul console raises IRQ 2 (STATUSF_IP2) while it holds input;
+ * the interrupt dispatcher, sched_intr(), calls cons_intr(), which
+ * drains the device through a line discipline into a ring buffer.  The line discipline
+ * echoes what is typed, turns CR into NL, and handles backspace/DEL
+ * (erase a char) and ^U (erase the line).  Readers only ever see whole
+ * lines, or a full buffer.
+ *
+ * Envs read with cons_read(), which sleeps on the console instead of
+ * spinning when there is no input.  The kernel itself has no env to
+ * switch to, so getchar() and readline() wait on the console in
+ * sched_wait(), whose idle loop takes the console interrupt.
+ */
+
+#define CONS_BUFSZ	128		// power of two
+
+/*
+ * Console output.
+ *
+ * cons_write() is where printf() and the echo end up.  Normally it
+ * writes straight to the device.  Once cons_tx_start() has been called,
+ * it only appends to a lock-free multi-producer ring and returns, and
+ * cons_tx_drain(), run from the idle loop in sched_yield() and on every
+ * clock tick, writes the ring out.  A producer that finds the ring full
+ * drains it itself.  A single busy cpu would leave output waiting for
+ * the next tick, so mp_init() only starts the ring when it brought up
+ * other cpus, which idle in the scheduler.
+ *
+ * cons_tx_sync() goes back to writing synchronously, for panic and
+ * anything else that must not leave output behind; cons_tx_flush()
+ * empties the ring before halting.
+ */
+
+#define CONS_TXSZ	4096		// power of two
+
+void cons_write(const char *s, int n);
+void cons_tx_start(void);
+void cons_tx_drain(void);
+void cons_tx_flush(void);
+void cons_tx_sync(void);
+
+void cons_intr(void);
+int cons_getc(void);
+int cons_read(char *buf, int n);
+#ifdef __x86_64__
+int _getchar(void);		// the C library has a getchar()
+#else
+int getchar(void);
+#endif
+char *readline(const char *prompt);
+
+#endif // !_CONS_H_
@@ -0,0 +1,66 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _DISK_H_
+#define _DISK_H_
+
+#include "types.h"
+#include "queue.h"
+
+/*
+ * Disk request queue.
+ *
+ * A request names a run of contiguous sectors on one disk and the
+ * buffers (scatter/gather) they go to or come from.  disk_submit()
+ * sorts it into an elevator queue; disk_run() serves the queue in one
+ * upward sweep from where the last batch ended (C-SCAN), taking every
+ * run of requests that are adjacent on disk and go the same way as one
+ * batch, back to back through disk_xfer().
+ *
+ * The GXemul disk has no interrupt: a transfer is done when disk_xfer()
+ * returns.  So whoever waits for a request drives the queue, and
+ * disk_wait() calls disk_run() until its request is done.  Completion
+ * also does sched_wakeup(req) for envs sleeping on it.
+ */
+
+#define SECT_SIZE	512
+#define DISK_NIOV	8
+
+struct disk_iov {
+	void *iov_base;			// word aligned
+	u_int iov_nsecs;
+};
+
+struct disk_req {
+	// filled in by the caller
+	int dr_diskno;
+	u_int dr_secno;			// first sector
+	int dr_write;
+	int dr_niov;
+	struct disk_iov dr_iov[DISK_NIOV];
+
+	// owned by the queue
+	u_int dr_nsecs;			// total over dr_iov
+	volatile int dr_done;
+	int dr_error;			// 0 or -E_IO
+	TAILQ_ENTRY(disk_req) dr_link;
+};
+
+struct disk_stats {
+	u_int ds_reqs;			// requests submitted
+	u_int ds_batches;		// batches sent to the device
+	u_int ds_merged;		// requests that joined a batch
+	u_int ds_sectors;		// sectors moved
+	u_int ds_errors;		// failed requests
+};
+
+extern struct disk_stats disk_stats;
+
+void disk_submit(struct disk_req *r);
+void disk_run(void);
+int disk_wait(struct disk_req *r);
+int disk_rw(int diskno, u_int secno, void *buf, u_int nsecs, int write);
+
+/* drivers/gxdisk/disk.c */
+int disk_xfer(int diskno, u_int secno, void *buf, u_int nsecs, int write);
+
+#endif // !_DISK_H_
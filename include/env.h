@@ -7,6 +7,7 @@
 #include "queue.h"
 #include "trap.h"
 #include "mmu.h" 
+#include "smp.h"
 
 #define LOG2NENV	10
 #define NENV		(1<<LOG2NENV)
@@ -26,6 +27,7 @@ struct Env {
 	u_int env_status;               // Status of the environment
 	Pde  *env_pgdir;                // Kernel virtual address of page dir
 	u_int env_cr3;
+	u_int env_asid;			// EntryHi ASID, shared by threads, see thread.h
 
 	// Lab 4 IPC
 	u_int env_ipc_value;            // data value sent to us 
@@ -40,14 +42,24 @@ struct Env {
 
 	// Lab 6 scheduler counts
 	u_int env_runs;			// number of times been env_run'ed
+
+	// run queue, see sched.h
+	TAILQ_ENTRY(Env) env_sched_link;	// NULL tqe_prev when not queued
+	int env_cpu;			// cpu that last ran or queued us, -1 if none
+	void *env_wchan;		// what we sleep on, see sched_sleep()
+	volatile u_int env_held;	// off its run queue, see sched_hold()
 };
 
 LIST_HEAD(Env_list, Env);
 extern struct Env *envs;		// All environments
-extern struct Env *curenv;	        // the current env
+#define curenv (mycpu()->cpu_env)	// the current env on this cpu
 
 void env_init(void);
 int env_alloc(struct Env **e, u_int parent_id);
+// env_alloc() without the address space, for thread_create(); both
+// take env_free_list's lock.  env_put() returns an env taken but unused.
+int env_take(struct Env **e, u_int parent_id);
+void env_put(struct Env *e);
 void env_free(struct Env *);
 void env_create(u_char *binary, int size);
 void env_destroy(struct Env *e);
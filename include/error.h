@@ -21,6 +21,9 @@
 #define E_FILE_EXISTS	11	// File already exists
 #define E_NOT_EXEC	12	// File not a valid executable
 
-#define MAXERROR 12
+#define E_IO		13	// The disk reported a failure
+#define E_AGAIN		14	// The value changed, try again
+
+#define MAXERROR 14
 
 #endif // _ERROR_H_
@@ -0,0 +1,101 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _FS_H_
+#define _FS_H_
+
+#include "types.h"
+#include "bcache.h"
+
+/*
+ * File system.
+ *
+ * On-disk layout, in BY2BLK blocks:
+ *
+ *	0		reserved for a boot loader
+ *	1		struct Super, holding the root directory's File
+ *	2 ...		free-block bitmap, s_nbitmap blocks, a set bit is free
+ *	...		files, directories and indirect extent blocks
+ *
+ * A file is a list of extents, runs of blocks that are contiguous on
+ * disk, not a list of block pointers.  The first NEXTENT extents live in
+ * the File itself, the rest in one indirect block.  A file that grows
+ * takes the block right after its last extent when it is free, so a file
+ * written sequentially is usually one extent, and reading it costs no
+ * metadata reads beyond the path lookup.
+ *
+ * Block b is bit 31 - b % 32 of word b / 32 of the bitmap: the count of
+ * leading zeros of a word is its lowest-numbered free block, and the
+ * allocator passes over 32 used blocks per load.
+ *
+ * A directory is a chain of open-addressed hash tables of File slots,
+ * each twice the size of the one before (table k is FILE2BLK << k slots
+ * from block 2^k - 1 of the directory).  New names go into the newest
+ * table, and a table that gets 3/4 full starts the next one.  A lookup
+ * reads about one block per table, newest first, and the newest holds
+ * half the entries: a thousand names take seven tables instead of 63
+ * blocks to scan.  Entries never move, so a File's place on disk is
+ * fixed while it exists.
+ *
+ * An open file is a struct Fnode: a copy of its File and where the File
+ * is on disk.  Keep one Fnode per file; file_write() writes the File back.
+ */
+
+#define FS_MAGIC	0x45585446	// "EXTF"
+
+#define MAXNAMELEN	128		// with the NUL
+#define MAXPATHLEN	1024
+
+#define NEXTENT		13		// extents in the File itself
+#define BY2FILE		256
+#define FILE2BLK	(BY2BLK / BY2FILE)
+#define BIT2BLK		(BY2BLK * 8)	// blocks mapped by a bitmap block
+
+#define FTYPE_REG	0
+#define FTYPE_DIR	1
+#define FTYPE_DEAD	2		// removed; f_name[0] == 0 too
+
+struct Extent {
+	u_int e_start;			// first disk block
+	u_int e_len;			// blocks
+};
+
+#define NINDEXTENT	(BY2BLK / sizeof(struct Extent))
+
+struct File {
+	char f_name[MAXNAMELEN];	// "" for a free or dead slot
+	u_int f_size;			// bytes
+	u_int f_type;
+	u_int f_nextent;		// extents in use, direct and indirect
+	struct Extent f_extent[NEXTENT];
+	u_int f_indirect;		// block of extents NEXTENT..., or 0
+
+	// directories
+	u_int f_dirfill;		// used and dead slots in the newest table
+	u_int f_dirlive;		// entries
+};
+
+struct Super {
+	u_int s_magic;
+	u_int s_nblocks;		// blocks on the disk
+	u_int s_nbitmap;		// bitmap blocks, from block 2
+	struct File s_root;
+};
+
+struct Fnode {
+	struct File fn_file;
+	u_int fn_block;			// disk block holding the File
+	u_int fn_offset;		// byte offset of the File in it
+};
+
+int fs_format(int diskno, u_int nblocks);
+int fs_mount(int diskno);
+int fs_sync(void);
+
+int file_open(const char *path, struct Fnode *fn);
+int file_create(const char *path, u_int type, struct Fnode *fn);
+int file_read(struct Fnode *fn, void *buf, u_int n, u_int offset);
+int file_write(struct Fnode *fn, const void *buf, u_int n, u_int offset);
+int file_getblock(struct Fnode *fn, u_int fileblock, struct buf **pbp);
+int file_remove(const char *path);
+
+#endif // !_FS_H_
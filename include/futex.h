@@ -0,0 +1,29 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _FUTEX_H_
+#define _FUTEX_H_
+
+#include "types.h"
+
+/*
+ * Futexes: blocking on a word of shared memory.
+ *
+ * futex_wait() puts curenv to sleep while the word at va still holds
+ * the value it expects; futex_wake() makes up to n of the envs waiting
+ * on that word runnable again.  The channel they sleep on is the word's
+ * physical address, so envs that map the shared page at different
+ * addresses still meet, and waiters are off every run queue until they
+ * are woken, rather than spinning through yields.
+ *
+ * futex_wait() compares the word and goes to sleep under the lock of
+ * the word's bucket, and futex_wake() takes the same lock, so a wake
+ * that follows a change of the word is never lost.  A lock built on it
+ * makes the system call only when it is contended.
+ */
+
+#define NFUTEXQ		16		// power of two
+
+int futex_wait(u_long va, u_int val);
+int futex_wake(u_long va, u_int n);
+
+#endif // !_FUTEX_H_
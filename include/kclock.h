@@ -3,6 +3,7 @@
 #ifndef _KCLOCK_H_
 #define _KCLOCK_H_
 #define	IO_RTC		0xb5000100		/* RTC port */
+#define	IO_RTC_ACK	(IO_RTC + 0x10)		/* write to ack a tick */
 #ifndef __ASSEMBLER__
 void kclock_init(void);
 #endif /* !__ASSEMBLER__ */
@@ -0,0 +1,81 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _KSTATS_H_
+#define _KSTATS_H_
+
+#include "types.h"
+#include "mmu.h"
+#include "atomic.h"
+
+/*
+ * Kernel statistics.
+ *
+ * A single page of counters, bumped from the hot paths with atomic
+ * increments (no locks, any cpu) and mapped read-only into every
+ * address space at UKSTATS, so user programs can read them without a
+ * system call.  Per-cpu numbers live in struct cpu (smp.h).
+ *
+ * Event counters only ever grow.  The page and env gauges are snapshots,
+ * refreshed by kstats_pages()/kstats_envs() when somebody asks for them.
+ */
+
+#define KS_NCAUSE	32	// CP0 Cause.ExcCode is 5 bits wide
+#define KS_NREF		8	// pp_ref histogram: 0,1,2,3,4-7,8-15,16-31,32+
+#define KS_NSTATUS	3	// ENV_FREE, ENV_RUNNABLE, ENV_NOT_RUNNABLE
+
+struct Kstats {
+	// event counters
+	u_int ks_page_alloc;		// successful page_alloc()s
+	u_int ks_page_free;		// page_free()s
+	u_int ks_tlb_refill;		// TLB refill exceptions
+	u_int ks_ctxsw;			// sched_yield() switching to another env
+	u_int ks_ipc_send;		// IPC messages delivered
+	u_int ks_swap_out;		// pages written to swap
+	u_int ks_swap_in;		// pages read back from swap
+	u_int ks_trap[KS_NCAUSE];	// exceptions, indexed by ExcCode
+
+	// gauges, see kstats_pages() and kstats_envs()
+	u_int ks_npage;			// physical pages managed
+	u_int ks_nfree;			// pages with pp_ref == 0
+	u_int ks_ref[KS_NREF];		// pp_ref distribution
+	u_int ks_env[KS_NSTATUS];	// envs in each env_status
+};
+
+/*
+ * The page mapped at UKSTATS is this one only: page aligned and padded
+ * to a page, so no other kernel data shares it.
+ */
+union kstats_page {
+	struct Kstats kp_stats;
+	char kp_page[BY2PG];
+};
+
+extern union kstats_page kstats_page;
+#define kstats	(kstats_page.kp_stats)
+
+extern int ncpu;		// cpus running, see smp.h
+
+/*
+ * Like spin_lock(), a plain increment while only one cpu runs: no LL/SC
+ * on R3000, where it is a reserved instruction.
+ */
+static inline void
+kstats_inc(volatile u_int *p)
+{
+	if (ncpu == 1)
+		(*p)++;
+	else
+		atomic_inc(p);
+}
+
+#define KSTATS_INC(field)	kstats_inc(&kstats.field)
+#define KSTATS_TRAP(cause)	kstats_inc(&kstats.ks_trap[((cause) >> 2) & (KS_NCAUSE - 1)])
+
+struct Page;
+struct Env;
+
+void kstats_pages(struct Page *pp, u_long n);
+void kstats_envs(struct Env *e, int n);
+void kstats_dump(void);
+
+#endif // !_KSTATS_H_
@@ -0,0 +1,119 @@
+#ifndef _LFQUEUE_H_
+#define _LFQUEUE_H_
+
+#include "types.h"
+#include "atomic.h"
+
+/*
+ * Lock-free intrusive lists, in the style of queue.h.
+ *
+ * A lock-free stack is headed by a single pointer that any number of
+ * cpus may push to and pop from at the same time.  Pops are built on
+ * LL/SC (atomic_pop_ptr), which makes them immune to ABA: a free list
+ * whose elements are freed and reallocated concurrently stays intact.
+ * Elements come back in LIFO order.
+ *
+ * A lock-free queue takes elements from any number of producers and
+ * hands them to a single consumer in FIFO order.  Producers push onto
+ * an inbound stack; when the consumer's private list runs dry it takes
+ * the whole inbound stack with one atomic swap and reverses it.  All
+ * operations are O(1) amortized.  Only the owner may dequeue, which is
+ * exactly the shape of a per-cpu queue fed by other cpus.
+ *
+ * Both push macros warn at compile time about an element whose type
+ * does not match the head.
+ */
+
+/*
+ * Lock-free stack declarations.
+ */
+#define	LFSTACK_HEAD(name, type)					\
+struct name {								\
+	struct type * volatile lsh_first;	/* top element */	\
+}
+
+#define	LFSTACK_HEAD_INITIALIZER(head)					\
+	{ NULL }
+
+#define	LFSTACK_ENTRY(type)						\
+struct {								\
+	struct type *lse_next;	/* next element */			\
+}
+
+/*
+ * Lock-free stack functions.
+ */
+#define	LFSTACK_INIT(head)	((head)->lsh_first = NULL)
+
+#define	LFSTACK_EMPTY(head)	((head)->lsh_first == NULL)
+
+#define	LFSTACK_PUSH(head, elm, field) do {				\
+	typeof((elm)) __lf_old;						\
+	(void)(&(head)->lsh_first == (typeof((elm)) volatile *)0);	\
+	do {								\
+		__lf_old = (head)->lsh_first;				\
+		(elm)->field.lse_next = __lf_old;			\
+	} while (!atomic_cmpxchg_ptr(&(head)->lsh_first, __lf_old, (elm)));\
+} while (0)
+
+/* Evaluates to the popped element, or NULL if the stack was empty. */
+#define	LFSTACK_POP(head, type, field)					\
+	((struct type *)atomic_pop_ptr((void * volatile *)&(head)->lsh_first,\
+	    offsetof(struct type, field.lse_next)))
+
+/*
+ * Lock-free queue declarations.
+ */
+#define	LFQUEUE_HEAD(name, type)					\
+struct name {								\
+	struct type * volatile lqh_in;	/* pushed by producers, LIFO */	\
+	struct type *lqh_out;		/* consumer's FIFO */		\
+}
+
+#define	LFQUEUE_HEAD_INITIALIZER(head)					\
+	{ NULL, NULL }
+
+#define	LFQUEUE_ENTRY(type)						\
+struct {								\
+	struct type *lqe_next;	/* next element */			\
+}
+
+/*
+ * Lock-free queue functions.
+ */
+#define	LFQUEUE_INIT(head) do {						\
+	(head)->lqh_in = NULL;						\
+	(head)->lqh_out = NULL;						\
+} while (0)
+
+#define	LFQUEUE_EMPTY(head)						\
+	((head)->lqh_out == NULL && (head)->lqh_in == NULL)
+
+/* Any cpu. */
+#define	LFQUEUE_ENQUEUE(head, elm, field) do {				\
+	typeof((elm)) __lf_old;						\
+	(void)(&(head)->lqh_in == (typeof((elm)) volatile *)0);		\
+	do {								\
+		__lf_old = (head)->lqh_in;				\
+		(elm)->field.lqe_next = __lf_old;			\
+	} while (!atomic_cmpxchg_ptr(&(head)->lqh_in, __lf_old, (elm)));\
+} while (0)
+
+/* Owner only.  Sets var to the oldest element, or NULL. */
+#define	LFQUEUE_DEQUEUE(head, var, field) do {				\
+	typeof((var)) __lf_in, __lf_next;				\
+	if ((head)->lqh_out == NULL && (head)->lqh_in != NULL) {	\
+		__lf_in = atomic_swap_ptr((void * volatile *)&(head)->lqh_in,\
+		    NULL);						\
+		while (__lf_in != NULL) {				\
+			__lf_next = __lf_in->field.lqe_next;		\
+			__lf_in->field.lqe_next = (head)->lqh_out;	\
+			(head)->lqh_out = __lf_in;			\
+			__lf_in = __lf_next;				\
+		}							\
+	}								\
+	if (((var) = (head)->lqh_out) != NULL)				\
+		(head)->lqh_out = (var)->field.lqe_next;		\
+} while (0)
+
+#endif /* !_LFQUEUE_H_ */
@@ -0,0 +1,53 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _MMAP_H_
+#define _MMAP_H_
+
+#include "types.h"
+#include "fs.h"
+
+/*
+ * Memory-mapped files.
+ *
+ * mmap_file() maps a page-aligned piece of a file into an env at va.
+ * Nothing is mapped yet: the first touch of each page faults, and the
+ * fault path (TLB refill of an unmapped va, or TLB mod for a write)
+ * calls mmap_fault(), which maps the buffer cache page holding that
+ * block of the file (BY2BLK == BY2PG) straight into the env.  The data
+ * is never copied, and envs mapping the same file share the pages.
+ *
+ * Writable mappings are entered without PTE_R, so the first write to a
+ * page traps once more and marks the buffer dirty.  Unmapping a page
+ * that was written to marks it dirty again, in case bcache_flush()
+ * wrote it back meanwhile, and starts the write-back.
+ *
+ * A mapped page pins its buffer, so at most NVPAGE pages are mapped at
+ * a time over all envs, leaving the rest of the cache to the file
+ * system.  When they are all taken, a fault unmaps the page mapped
+ * longest ago that it can take: one of the faulting env, unless threads
+ * share its space, or of an env held off every cpu with pmap_hold()
+ * (pgrange.h), so no cpu keeps a TLB entry for a buffer about to be
+ * reused.  Its env faults it back in if it touches it again.
+ */
+
+#define NVMAP		32		// mappings, over all envs
+#define NVPAGE		(NBUF / 2)	// pages mapped at once
+
+struct Env;
+
+struct Vmap {
+	struct Env *v_env;		// NULL if free
+	u_long v_va;
+	u_int v_npage;
+	u_int v_perm;			// PTE_R if writable
+	u_int v_offset;			// in the file, page aligned
+	struct Fnode v_fnode;
+};
+
+int mmap_file(struct Env *e, u_long va, u_int len, struct Fnode *fn,
+	      u_int offset, u_int perm);
+int munmap_file(struct Env *e, u_long va);
+int mmap_fault(struct Env *e, u_long va, int write);
+void mmap_env_free(struct Env *e);
+
+#endif // !_MMAP_H_
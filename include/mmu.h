@@ -61,7 +61,9 @@
  o      UVPT     -----> +----------------------------+------------0x7fc0 0000    |
  o                      |         PAGES              |     PDMAP                 |
  o      UPAGES   -----> +----------------------------+------------0x7f80 0000    |
- o                      |         ENVS               |     PDMAP                 |
+ o                      |         KSTATS             |     BY2PG                 |
+ o      UKSTATS  -----> +----------------------------+------------0x7f7f f000    |
+ o                      |         ENVS               |  PDMAP - BY2PG            |
  o  UTOP,UENVS   -----> +----------------------------+------------0x7f40 0000    |
  o  UXSTACKTOP -/       |     user exception stack   |     BY2PG                 |
  o                      +----------------------------+------------0x7f3f f000    |
@@ -92,6 +94,7 @@
 #define UVPT (ULIM - PDMAP)
 #define UPAGES (UVPT - PDMAP)
 #define UENVS (UPAGES - PDMAP)
+#define UKSTATS (UPAGES - BY2PG)	// read-only struct Kstats, see kstats.h
 
 #define UTOP UENVS
 #define UXSTACKTOP (0x82000000)
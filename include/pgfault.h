@@ -0,0 +1,55 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _PGFAULT_H_
+#define _PGFAULT_H_
+
+/*
+ * User page fault upcall.
+ *
+ * An env that registered env_pgfault_handler gets its page faults back
+ * in user mode.  pgfault_upcall() writes a struct UFault, 16 bytes and
+ * not a whole Trapframe, onto the env's exception stack and points the
+ * saved sp and EPC at it and at the handler, so the normal return from
+ * the exception lands in the handler with every other register as it
+ * was at the fault.  A fault taken on the exception stack itself pushes
+ * the new record below the old one.
+ *
+ * The handler (user/pgfault.S) saves what C code may clobber, calls the
+ * C handler, restores and goes back to uf_epc through the UF_RESUME_LEN
+ * bytes right before the entry point, without another trip through the
+ * kernel.  That sequence needs k0 and k1, which no exception preserves,
+ * so the kernel restarts it from where it is safe to if it interrupts
+ * it: pgfault_fixup() is run on every exception from such an env.
+ */
+
+#define UF_VA		0
+#define UF_CAUSE	4
+#define UF_EPC		8
+#define UF_SP		12
+#define UF_SIZE		16
+
+#define UF_GAP		8		// left between nested records
+
+#define UF_RESUME_LEN		36	// the resume sequence, before the entry
+#define UF_RESUME_RELOAD	20	// its second restart point
+
+#ifndef __ASSEMBLER__
+
+#include "types.h"
+
+struct UFault {
+	u_int uf_va;			// CP0 BadVAddr
+	u_int uf_cause;			// CP0 Cause
+	u_int uf_epc;			// where to resume
+	u_int uf_sp;			// sp to resume with
+};
+
+struct Env;
+struct Trapframe;
+
+int pgfault_upcall(struct Env *e, struct Trapframe *tf);
+void pgfault_fixup(struct Env *e, struct Trapframe *tf);
+
+#endif /* !__ASSEMBLER__ */
+
+#endif // !_PGFAULT_H_
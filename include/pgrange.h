@@ -0,0 +1,88 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _PGRANGE_H_
+#define _PGRANGE_H_
+
+#include "types.h"
+#include "mmu.h"
+#include "smp.h"
+
+/*
+ * Page table ranges.
+ *
+ * pgdir_walk() and friends go through the page directory for every
+ * page.  A struct pgrange walks [va, va + size) page by page instead,
+ * keeping the page table it is in and going back to the directory only
+ * every PDMAP bytes; without create it skips a missing page table in
+ * one step.  pgrange_next() returns the Pte of each page in turn, with
+ * its va in pr_va.
+ *
+ * Changing a valid Pte calls for pgrange_inval().  pgrange_done() then
+ * drops the stale TLB entries one at a time if there are at most
+ * PR_NINVAL of them, and otherwise flushes the whole TLB in one sweep,
+ * cheaper than that many probes.
+ *
+ * The pmap_*_range() calls are built on it, for fork, env teardown and
+ * large IPC mappings.
+ *
+ * The TLB of another cpu may still hold entries of an env that ran
+ * there.  Whoever changes the page tables of an env that is off every
+ * cpu calls tlb_shootdown() before letting it run again; env_run()
+ * calls tlb_sync(), which flushes the TLB once if it has been called
+ * since this cpu last looked.
+ *
+ * Page merging and swap change the page tables of other envs this way:
+ * pmap_hold() takes an env that has its space to itself off every cpu
+ * (sched_hold()), and pmap_release() lets it go again, after a
+ * tlb_shootdown() if any of its Ptes changed.  Thread spaces are never
+ * held, since a sibling may be running.
+ */
+
+#define PR_NINVAL	16
+#define NTLB_R3000	64		// a MIPS32 cpu has its count in Config1
+
+struct pgrange {
+	Pde *pr_pgdir;
+	u_long pr_va;			// va of the Pte last returned
+	u_long pr_next;			// va to visit next
+	u_long pr_end;
+	int pr_create;			// allocate missing page tables
+	int pr_error;			// -E_NO_MEM if that failed
+	Pte *pr_pt;			// page table pr_ptva is in, or NULL
+	u_long pr_ptva;			// PDMAP aligned
+	u_int pr_ninval;		// > PR_NINVAL: flush everything
+	u_long pr_inval[PR_NINVAL];
+};
+
+void pgrange_init(struct pgrange *pr, Pde *pgdir, u_long va, u_long size,
+		  int create);
+void pgrange_seek(struct pgrange *pr, u_long va);
+Pte *pgrange_next(struct pgrange *pr);
+void pgrange_inval(struct pgrange *pr);
+void pgrange_done(struct pgrange *pr);
+
+int pmap_map_range(Pde *pgdir, u_long va, Pde *src, u_long srcva,
+		   u_long size, u_int perm);
+void pmap_unmap_range(Pde *pgdir, u_long va, u_long size);
+void pmap_protect_range(Pde *pgdir, u_long va, u_long size, u_int perm);
+void pmap_translate_range(Pde *pgdir, u_long va, u_long npage, u_long *pa);
+void tlb_flush_all(void);
+void tlb_shootdown(void);
+
+struct Env;
+
+int pmap_hold(struct Env *e);
+void pmap_release(struct Env *e, int changed);
+
+extern volatile u_int tlb_gen;
+
+static inline void
+tlb_sync(struct cpu *c)
+{
+	if (c->cpu_tlbgen != tlb_gen) {
+		c->cpu_tlbgen = tlb_gen;
+		tlb_flush_all();
+	}
+}
+
+#endif // !_PGRANGE_H_
@@ -2,13 +2,14 @@
 #define _PMAP_H_
 
 #include "types.h"
-#include "queue.h"
+#include "lfqueue.h"
 #include "mmu.h"
 #include "printf.h"
 
 
-LIST_HEAD(Page_list, Page);
-typedef LIST_ENTRY(Page) Page_LIST_entry_t;
+// page_alloc() and page_free() take no lock, see lfqueue.h
+LFSTACK_HEAD(Page_list, Page);
+typedef LFSTACK_ENTRY(Page) Page_LIST_entry_t;
 
 struct Page {
 	Page_LIST_entry_t pp_link;	/* free list link */
@@ -19,6 +20,7 @@ struct Page {
 	// do not have valid reference count fields.
 
 	u_short pp_ref;
+	u_short pp_flags;		/* PP_*, cleared by page_free */
 };
 
 extern struct Page *pages;
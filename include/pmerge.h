@@ -0,0 +1,49 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _PMERGE_H_
+#define _PMERGE_H_
+
+#include "types.h"
+#include "mmu.h"
+
+/*
+ * Same-page merging.
+ *
+ * Envs started from the same binary end up with many private pages
+ * holding the same bytes.  pmerge_scan(), run from the idle loop, walks
+ * the user pages of one env after another, a budget of pages per call,
+ * and hashes every private writable page.  A page equal to a merged one
+ * is replaced by it; a page equal to one seen earlier, a candidate,
+ * turns that one into a merged page and is replaced by it.  Hashes only
+ * pick what to compare: pages are merged only if their bytes are equal.
+ *
+ * A merged page has PP_MERGED set and is mapped read-only with
+ * PTE_MERGED, which stands for PTE_R as far as the env can tell.  The
+ * first write to it gets to pmerge_fault() from the TLB Mod handler,
+ * which gives the writer a copy of its own, or the page itself if it is
+ * the last one mapping it.
+ *
+ * An env is only scanned while it is held off every cpu and off its run
+ * queue (pmap_hold(), see pgrange.h), so neither it nor a stale TLB
+ * entry can write a page being compared; if a page was merged,
+ * tlb_shootdown() goes before it is queued again.  Threads share their
+ * space with envs that may be running, so their spaces are left alone.
+ *
+ * pp_ref is a u_short: a merged page takes no more than PM_MAXREF
+ * mappings, leaving room for fork and IPC to map it again.  The next
+ * equal page starts another merged page.
+ */
+
+#define PTE_MERGED	0x0008		// merged page, writable through a copy
+#define PP_MERGED	0x0001		// pp_flags: page is merged
+
+#define PM_MAXREF	0x8000
+#define PM_NSTABLE	256		// merged pages remembered, power of 2
+#define PM_NCAND	1024		// candidates remembered, power of 2
+
+extern u_int pmerge_nfreed;
+
+void pmerge_scan(u_int budget);
+int pmerge_fault(Pde *pgdir, u_long va);
+
+#endif // !_PMERGE_H_
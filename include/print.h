@@ -14,8 +14,8 @@
 
 #include <stdarg.h>
 
-/* this is the maximum width for a variable */
-#define		LP_MAX_BUF	80
+/* room for the longest number: a sign and the 64 digits of %llb */
+#define		LP_NUM_BUF	(8 * sizeof(u_quad_t) + 1)
 
 /* -*-
  * output function takes an void pointer which is passed in as the
@@ -26,7 +26,8 @@
  * The third argument specifies the number of chars to outputed.
  *
  * output function cannot assume the buffer is null-terminated after
- * l number of chars.
+ * l number of chars.  A NUL is output like any other char; lp_Print()
+ * ends with one call with l == 0.
  */
 void lp_Print(void (*output)(void *, char *, int), 
 	      void * arg,
@@ -17,9 +17,13 @@
 #ifdef __x86_64__
 
 void _printf(char *fmt, ...);
+int _snprintf(char *buf, int size, const char *fmt, ...);
+int _vsnprintf(char *buf, int size, const char *fmt, va_list ap);
 
 #else
 void printf(char *fmt, ...);
+int snprintf(char *buf, int size, const char *fmt, ...);
+int vsnprintf(char *buf, int size, const char *fmt, va_list ap);
 #endif
 void _panic(const char *, int, const char *, ...) 
 	__attribute__((noreturn));
@@ -0,0 +1,83 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _PROF_H_
+#define _PROF_H_
+
+#include "types.h"
+#include "smp.h"
+
+/*
+ * Cycle profiling of kernel paths.
+ *
+ *	u_int t = prof_begin();
+ *	...
+ *	prof_end(PROF_SITE(tlb_refill), t);
+ *
+ * Every PROF_SITE() is a static probe site registered in a fixed table
+ * the first time it is hit; prof_register() looks again under its lock,
+ * so cpus racing to the first hit get the same entry.  A site keeps
+ * min/avg/max and a log2 histogram of the CP0 Count deltas it has seen,
+ * one set per cpu so prof_end() needs neither locks nor atomics;
+ * prof_dump() adds them up and is also called from _panic().  Count
+ * runs at half the pipeline clock on MIPS32 cores, so the numbers are
+ * Count ticks, not cycles.
+ *
+ * Sampling: between prof_sample_start() and prof_sample_stop() every
+ * clock tick, in sched_intr(), calls prof_tick() with the interrupted
+ * Trapframe, which records its cp0_epc in a buffer of the cpu's own.
+ * prof_sample_dump() prints the buffers for tools/prof_symbolize.sh to
+ * turn into a flat profile.
+ */
+
+#define PROF_NSITE	32
+#define PROF_NBUCKET	16	// bucket i holds deltas in [2^i, 2^(i+1))
+#define PROF_NSAMPLE	1024	// pc samples kept per cpu and run
+
+struct prof_count {
+	u_int pc_hits;
+	u_int pc_min;			// valid once pc_hits != 0
+	u_int pc_max;
+	u_quad_t pc_total;
+	u_int pc_hist[PROF_NBUCKET];
+} __attribute__((aligned(CACHE_LINE)));
+
+struct prof_site {
+	const char *ps_name;
+	struct prof_count ps_cpu[NCPU];	// written only by that cpu
+};
+
+static inline u_int
+prof_count(void)
+{
+	u_int c;
+
+#ifdef __x86_64__
+	u_int hi;
+	asm volatile("rdtsc" : "=a"(c), "=d"(hi));
+#else
+	asm volatile("mfc0 %0, $9" : "=r"(c));
+#endif
+	return c;
+}
+
+#define prof_begin()	prof_count()
+
+#define PROF_SITE(name)						\
+({								\
+	static struct prof_site *__ps;				\
+	__ps ? __ps : prof_register(&__ps, #name);		\
+})
+
+struct prof_site *prof_register(struct prof_site **pps, const char *name);
+void prof_end(struct prof_site *ps, u_int t0);
+void prof_reset(void);
+void prof_dump(void);
+
+struct Trapframe;
+
+void prof_sample_start(void);
+void prof_sample_stop(void);
+void prof_tick(struct Trapframe *tf);
+void prof_sample_dump(void);
+
+#endif // !_PROF_H_
@@ -3,8 +3,77 @@
 #ifndef __SCHED_H__
 #define __SCHED_H__
 
+#include "types.h"
+#include "queue.h"
+#include "spinlock.h"
+
+/*
+ * Per-cpu run queues.
+ *
+ * Every cpu owns a FIFO of runnable envs in its struct cpu (smp.h).
+ * An env is queued on the cpu that last ran it (env_cpu) so it finds
+ * its TLB entries and cache lines still warm.  A cpu whose queue runs
+ * dry steals half of the queue of the busiest cpu.
+ *
+ * sched_yield() switches envs: it puts curenv back with sched_enqueue(),
+ * if it is still runnable, and runs what sched_pick() returns, idling
+ * until there is something.  The clock interrupt calls it through
+ * sched_intr(), and so does an env giving up the cpu.  curenv's
+ * registers must already be saved in its env_tf: once it is back on a
+ * run queue, another cpu may run it.  sched_dequeue() takes a runnable
+ * env off its queue, for whoever needs it to stay put for a while.  Every
+ * change of env_status between ENV_RUNNABLE and ENV_NOT_RUNNABLE is
+ * made under the lock of the env's run queue, so sched_dequeue() can
+ * tell an env on a run queue from one on a sleep queue.
+ *
+ * Kernel code working on an env from another cpu, like page merging and
+ * swap, takes it with sched_hold() instead and gives it back with
+ * sched_release().  A runnable env is held off its run queue; one
+ * asleep on a channel stays where it is, but if it is woken meanwhile
+ * sched_enqueue() only marks it runnable, and sched_release() queues it.  env_destroy() calls sched_forget(), which waits
+ * for the holder to let go, so a held env is never freed under it, and
+ * makes sched_release() leave the env off its run queue.
+ *
+ * An env waiting for an event sleeps on a channel, any address that
+ * names the event.  sched_sleep() takes curenv off its run queue and
+ * parks it, through the same env_sched_link, on a hashed sleep queue;
+ * sched_wakeup() puts every env sleeping on the channel back on a run
+ * queue; sched_wakeup_n() wakes only the n that went to sleep first.
+ * Call sched_sleep() with the lock that guards the event held, and
+ * sched_wakeup() after changing the event under that lock, so no wakeup
+ * is lost.  sched_sleep() does not switch: the caller leaves the kernel
+ * through sched_yield().
+ *
+ * The kernel waiting on its own behalf, with no env to put to sleep,
+ * calls sched_wait() with the event's lock held instead.  It marks the
+ * cpu as waiting on the channel, drops the lock and runs the idle loop,
+ * which takes device interrupts, until sched_wakeup() of the channel;
+ * it returns with the lock held again.
+ */
+
+#define NSLEEPQ		16
+
+struct Env;
+TAILQ_HEAD(Env_tailq, Env);
+
+struct runq {
+	struct spinlock rq_lock;
+	struct Env_tailq rq_envs;
+	volatile u_int rq_len;		// read without the lock to pick victims
+};
+
 void sched_init(void);
+void sched_enqueue(struct Env *e);
+int sched_dequeue(struct Env *e);
+int sched_hold(struct Env *e);
+void sched_release(struct Env *e);
+void sched_forget(struct Env *e);
+struct Env *sched_pick(void);
+void sched_sleep(void *chan);
+void sched_wakeup(void *chan);
+u_int sched_wakeup_n(void *chan, u_int n);
+void sched_wait(void *chan, struct spinlock *lk);
 void sched_yield(void);
-void sched_intr(int); 
+void sched_intr(int);
 
 #endif /* __SCHED_H__ */
@@ -0,0 +1,55 @@
+#ifndef _SMP_H_
+#define _SMP_H_
+
+#include "types.h"
+#include "mmu.h"
+#include "cache.h"
+#include "sched.h"
+
+/*
+ * Multiprocessor support for GXemul's testmips machine.
+ *
+ * cpu 0 boots through _start; mp_init() then starts every other cpu at
+ * _start_secondary on its own kernel stack, where it sets up its CP0
+ * state and enters mp_main().  Everything a cpu owns lives in its
+ * struct cpu, one cache line apart from its neighbours.
+ */
+
+#define NCPU		8
+#define CPU_ALIGN	CACHE_LINE
+
+struct Env;
+
+struct cpu {
+	u_int cpu_id;
+	volatile u_int cpu_started;
+	struct Env *cpu_env;		// env running on this cpu, or NULL
+	u_long cpu_kstacktop;
+	u_int cpu_cr3;			// address space loaded here, see thread.h
+	void * volatile cpu_wchan;	// what the kernel waits for, see sched_wait()
+	u_int cpu_tlbgen;		// tlb_gen last synced to, see pgrange.h
+	struct runq cpu_runq;		// envs waiting to run here
+
+	// per-cpu statistics, see also kstats.h
+	u_int cpu_ctxsw;		// envs switched to on this cpu
+	u_int cpu_idle;			// idle loop iterations
+} __attribute__((aligned(CPU_ALIGN)));
+
+extern struct cpu cpus[NCPU];
+extern int ncpu;
+
+/* drivers/gxmp/mp.c */
+int mp_whoami(void);
+int mp_ncpus(void);
+void mp_startcpu(int cpu, u_long pc, u_long sp);
+
+static inline struct cpu *
+mycpu(void)
+{
+	return &cpus[mp_whoami()];
+}
+
+void mp_init(void);
+void mp_main(void);
+
+#endif /* _SMP_H_ */
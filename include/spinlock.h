@@ -0,0 +1,70 @@
+#ifndef _SPINLOCK_H_
+#define _SPINLOCK_H_
+
+#include "types.h"
+#include "atomic.h"
+
+/*
+ * Test-and-test-and-set spinlocks.
+ *
+ * The kernel runs with interrupts disabled, so a lock holder cannot be
+ * interrupted on its own cpu and nothing here touches CP0_STATUS.
+ * While only cpu 0 runs (before mp_init(), or on a single cpu machine)
+ * locking is skipped altogether, which also keeps LL/SC off R3000.
+ */
+
+extern int ncpu;		// cpus running, see smp.h
+
+struct spinlock {
+	volatile u_int locked;
+	const char *name;
+};
+
+#define SPINLOCK_INITIALIZER(n)	{ 0, (n) }
+
+static inline void
+spin_init(struct spinlock *lk, const char *name)
+{
+	lk->locked = 0;
+	lk->name = name;
+}
+
+static inline void
+spin_lock(struct spinlock *lk)
+{
+	if (ncpu == 1)
+		return;
+	for (;;) {
+		while (lk->locked)
+			;
+		if (atomic_cmpxchg(&lk->locked, 0, 1))
+			return;
+	}
+}
+
+static inline int
+spin_trylock(struct spinlock *lk)
+{
+	if (ncpu == 1)
+		return 1;
+	return !lk->locked && atomic_cmpxchg(&lk->locked, 0, 1);
+}
+
+static inline void
+spin_unlock(struct spinlock *lk)
+{
+	if (ncpu == 1)
+		return;
+	mb();
+	lk->locked = 0;
+}
+
+/* mb() for data other cpus read without a lock; sync is MIPS II too. */
+static inline void
+smp_mb(void)
+{
+	if (ncpu > 1)
+		mb();
+}
+
+#endif /* _SPINLOCK_H_ */
@@ -0,0 +1,56 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _SWAP_H_
+#define _SWAP_H_
+
+#include "types.h"
+#include "mmu.h"
+#include "disk.h"
+
+/*
+ * Swap.
+ *
+ * When page_alloc() has nothing left, swap_page_alloc() calls
+ * swap_out(), which writes cold user pages to a swap area on disk
+ * SWAP_DISKNO and frees them, then tries again.
+ *
+ * Cold is decided by a clock over the user pages of all envs, with
+ * PTE_A as the reference bit.  The hardware has none: the TLB refill
+ * handler sets PTE_A in every Pte it loads.  The hand clears PTE_A of
+ * the pages it passes and drops their TLB entries, so a page used
+ * since comes back through the refill handler and has PTE_A again when
+ * the hand next gets there; a page without it is written out.  As for
+ * same-page merging (pmerge.h), an env is only looked at while it is
+ * held off every cpu (pmap_hold()), and if a Pte of it changed,
+ * tlb_shootdown() goes before it runs again; thread spaces are
+ * skipped.  Envs asleep, on IPC or a futex, are held as well: theirs
+ * are likely the coldest pages.  Only pages mapped once, and not merged or uncached, are
+ * candidates.
+ *
+ * A swapped-out page leaves a Pte without PTE_V, holding PTE_SWAP, its
+ * permissions and its slot number in place of the page number.  The
+ * slots of a batch come from a next-fit allocator, so they are mostly
+ * adjacent on disk and the disk queue sends them as one batch.
+ * swap_fault(), called by the TLB refill and invalid handlers for such
+ * a Pte, reads the page back and frees its slot; swap_discard() frees
+ * the slots of a range being torn down.
+ */
+
+#define PTE_A		0x0010		// referenced, set by the TLB refill handler
+#define PTE_SWAP	0x0020		// not valid: PTE_ADDR() holds a swap slot
+
+#define SWAP_DISKNO	1
+#define SWAP_SECNO	0		// where the swap area starts on it
+#define SWAP_NSLOT	4096		// pages, 16MB
+#define SWAP_BATCH	16		// pages written out per swap_out() try
+
+#define SWAP_SLOT2SECT(slot)	(SWAP_SECNO + (slot) * (BY2PG / SECT_SIZE))
+
+struct Page;
+
+u_int swap_out(u_int npage);
+int swap_page_alloc(struct Page **pp);
+int swap_fault(Pde *pgdir, u_long va);
+void swap_discard(Pde *pgdir, u_long va, u_long size);
+
+#endif // !_SWAP_H_
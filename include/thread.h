@@ -0,0 +1,60 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef _THREAD_H_
+#define _THREAD_H_
+
+#include "types.h"
+#include "mmu.h"
+#include "env.h"
+
+/*
+ * Threads: envs sharing one address space.
+ *
+ * thread_create() takes an env with env_take(), env_alloc() without the
+ * address space, and gives it the env_pgdir, env_cr3 and env_asid of
+ * an existing env, the leader, instead of a page directory of its own:
+ * no page table is copied or built.  The page holding the directory
+ * counts the envs using it in pp_ref, and only the last one to go tears
+ * the space down.  bench/bench_thread.c compares both ways.
+ *
+ * Every thread gets a stack slot of THREAD_STKSIZE bytes below
+ * USTACKTOP chosen by ENVX() of its env_id, so no two live envs ever
+ * pick the same one and no slot bookkeeping is needed.  The top page
+ * of the slot is mapped as its stack, and the bottom one as its
+ * exception stack if the leader has a page fault handler; a page in
+ * between is left unmapped as a guard.
+ *
+ * Sharing the ASID keeps the TLB entries of one thread good for all.
+ * thread_loadspace() tells env_run() whether the cpu already has the
+ * space of the env it is about to run, so a switch between threads of
+ * one space leaves EntryHi's ASID and the page table pointer alone.
+ * tlb_invalidate() only reaches the calling cpu: a thread that unmaps
+ * memory a sibling is using on another cpu has to get the sibling
+ * into the kernel first.  thread_put_space() calls tlb_shootdown(), so
+ * no cpu keeps the stack slot of a dead thread once it switches envs.
+ */
+
+#define THREAD_STKSIZE	(8 * BY2PG)
+
+// top of the stack slot of the env envid
+#define THREAD_STACKTOP(envid)	\
+	(USTACKTOP - (ENVX(envid) + 1) * THREAD_STKSIZE)
+
+int thread_create(struct Env **pe, struct Env *leader, u_long pc,
+		  u_long arg);
+int thread_put_space(struct Env *e);
+
+/* Overview:
+ *	Record that c runs e next.  Returns 1 if c has to load e's ASID
+ *	and page directory, 0 if they are already there.
+ */
+static inline int
+thread_loadspace(struct cpu *c, struct Env *e)
+{
+	if (c->cpu_cr3 == e->env_cr3)
+		return 0;
+	c->cpu_cr3 = e->env_cr3;
+	return 1;
+}
+
+#endif // !_THREAD_H_
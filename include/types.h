@@ -41,7 +41,7 @@ typedef u_int32_t        size_t;
 /* Static assert, for compile-time assertion checking */
 #define static_assert(c) switch (c) case 0: case(c):
 
-#define offsetof(type, member)  ((size_t)(&((type *)0)->member))
+#define offsetof(type, member)  ((size_t)(u_long)(&((type *)0)->member))
 
 /* Rounding; only works for n = power of two */
 #define ROUND(a, n)	(((((u_long)(a))+(n)-1)) & ~((n)-1))
@@ -4,12 +4,17 @@
 #include <printf.h>
 #include <kclock.h>
 #include <trap.h>
+#include <smp.h>
+#include <sched.h>
 
 
 void mips_init()
 {
 	printf("init.c:\tmips_init() is called\n");
 
+	sched_init();
+	mp_init();
+
 
 	//for your degree,don't delete these.
 	//------------|
@@ -0,0 +1,97 @@
+/*
+ * Fixed performance workload, run by "make perf" through the FTEST hook
+ * in mips_init().  Each phase prints one "perf <metric> <value>" line
+ * with its CP0 Count delta; tools/perf_run.sh compares those lines
+ * against gxemul/perf_baseline.  Changing a phase changes its numbers,
+ * so refresh the baseline with "make perf-update" when you do.
+ */
+
+#include <printf.h>
+#include <cons.h>
+#include <print.h>
+#include <prof.h>
+#include <queue.h>
+#include <types.h>
+
+void halt(void);
+
+#define PERF_ROUNDS	256
+
+struct perf_elem {
+	TAILQ_ENTRY(perf_elem) link;
+	int val;
+};
+
+TAILQ_HEAD(perf_list, perf_elem);
+
+static struct perf_elem perf_elems[64];
+static u_int perf_mem[16384];		// 64KB, larger than the caches
+static volatile u_int perf_sink;
+
+static void
+perf_null_output(void *arg, char *s, int l)
+{
+	*(int *)arg += l;
+}
+
+static void
+perf_format(int *n, char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	lp_Print(perf_null_output, n, fmt, ap);
+	va_end(ap);
+}
+
+static void
+perf_report(char *metric, u_int t0)
+{
+	printf("perf %s %u\n", metric, prof_count() - t0);
+}
+
+void
+perf_workload(void)
+{
+	struct perf_list head;
+	struct perf_elem *e;
+	int i, j, n = 0;
+	u_int sum = 0;
+	u_int t;
+
+	t = prof_count();
+	for (i = 0; i < PERF_ROUNDS; i++)
+		perf_format(&n, "env %08x: status %d, runs %d, name %s\n",
+					0x1000 + i, i & 3, i, "perf");
+	perf_report("format", t);
+
+	t = prof_count();
+	for (i = 0; i < PERF_ROUNDS / 16; i++)
+		printf("perf line %d\n", i);
+	perf_report("console", t);
+
+	t = prof_count();
+	TAILQ_INIT(&head);
+	for (i = 0; i < 64; i++)
+		TAILQ_INSERT_TAIL(&head, &perf_elems[i], link);
+	for (i = 0; i < PERF_ROUNDS * 16; i++) {
+		e = head.tqh_first;
+		TAILQ_REMOVE(&head, e, link);
+		TAILQ_INSERT_TAIL(&head, e, link);
+	}
+	perf_report("queue", t);
+
+	t = prof_count();
+	for (j = 0; j < 4; j++) {
+		for (i = 0; i < sizeof(perf_mem) / sizeof(perf_mem[0]); i++)
+			perf_mem[i] = i ^ j;
+		for (i = 0; i < sizeof(perf_mem) / sizeof(perf_mem[0]); i++)
+			sum += perf_mem[i];
+	}
+	perf_report("memory", t);
+
+	perf_sink = n + sum;
+	printf("perf done\n");
+	cons_tx_flush();
+	halt();
+}
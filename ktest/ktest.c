@@ -0,0 +1,68 @@
+/*
+ * Host test runner, see ktest.h.
+ *
+ *	usage: ktest [filter]
+ *
+ * filter restricts the run to tests whose name contains it.  Exits
+ * non-zero if any check failed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ktest.h"
+
+/* the kernel headers clash with the C library's */
+void page_init(void);
+void env_init(void);
+void sched_init(void);
+int bcache_init(void);
+
+static const struct ktest *tables[] = {
+	bcache_tests,
+	fs_tests,
+	mmap_tests,
+	pgrange_tests,
+	futex_tests,
+	thread_tests,
+	pmerge_tests,
+	swap_tests,
+	sched_tests,
+	cons_tests,
+};
+
+static int failed, checked;
+
+int
+ktest_check(int ok, const char *file, int line, const char *what)
+{
+	checked++;
+	if (!ok) {
+		failed++;
+		printf("FAIL %s:%d: %s\n", file, line, what);
+	}
+	return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+	const char *filter = argc > 1 ? argv[1] : NULL;
+	const struct ktest *t;
+	unsigned i;
+
+	page_init();
+	env_init();
+	sched_init();
+	if (bcache_init() < 0) {
+		printf("ktest: no memory for the buffer cache\n");
+		return 1;
+	}
+
+	for (i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+		for (t = tables[i]; t->name; t++)
+			if (!filter || strstr(t->name, filter))
+				t->fn();
+
+	printf("ktest: %d of %d checks pass\n", checked - failed, checked);
+	return failed != 0;
+}
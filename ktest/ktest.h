@@ -0,0 +1,34 @@
+/*
+ * Host tests of the kernel library.
+ *
+ * A test drives one subsystem through the device and pmap stand-ins of
+ * test.c and test_pmap.c, checking what it sees with KT_CHECK().  Every
+ * failed check is reported with its line; the runner counts them.
+ */
+
+#ifndef _KTEST_H_
+#define _KTEST_H_
+
+struct ktest {
+	const char *name;
+	void (*fn)(void);
+};
+
+/* Tables terminated by an entry with a NULL name. */
+extern const struct ktest bcache_tests[];
+extern const struct ktest fs_tests[];
+extern const struct ktest mmap_tests[];
+extern const struct ktest pgrange_tests[];
+extern const struct ktest futex_tests[];
+extern const struct ktest thread_tests[];
+extern const struct ktest pmerge_tests[];
+extern const struct ktest swap_tests[];
+extern const struct ktest sched_tests[];
+extern const struct ktest cons_tests[];
+
+int ktest_check(int ok, const char *file, int line, const char *what);
+
+/* Evaluates to c, so a test can stop at a failed precondition. */
+#define KT_CHECK(c)	ktest_check(!!(c), __FILE__, __LINE__, #c)
+
+#endif /* _KTEST_H_ */
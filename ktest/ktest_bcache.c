@@ -0,0 +1,145 @@
+/*
+ * Buffer cache tests against the host RAM disk: hits and misses,
+ * write-back, least recently used recycling, failed write-backs and
+ * sequential read-ahead.
+ * The blocks used here are outside the ones the file system tests
+ * format.
+ */
+
+#include <bcache.h>
+#include "../test.h"
+#include "ktest.h"
+
+#define BLK0	900			// first block these tests use
+
+static u_char *
+disk_block(u_int blockno)
+{
+	return host_disk[0][blockno * BLK2SECT];
+}
+
+static void
+test_hit(void)
+{
+	struct bcache_stats s0 = bcache_stats;
+	struct buf *b, *b2;
+
+	disk_block(BLK0)[7] = 0x5a;
+	if (!KT_CHECK((b = bread(0, BLK0)) != NULL))
+		return;
+	KT_CHECK(b->b_data[7] == 0x5a);
+	KT_CHECK(bcache_stats.bs_misses == s0.bs_misses + 1);
+	brelse(b);
+
+	b2 = bread(0, BLK0);
+	KT_CHECK(b2 == b);
+	KT_CHECK(bcache_stats.bs_hits == s0.bs_hits + 1);
+	brelse(b2);
+}
+
+static void
+test_writeback(void)
+{
+	struct bcache_stats s0 = bcache_stats;
+	struct buf *b;
+
+	if (!KT_CHECK((b = bread(0, BLK0 + 1)) != NULL))
+		return;
+	b->b_data[BY2BLK - 1] = 0xa5;
+	bdirty(b);
+	brelse(b);
+	KT_CHECK(disk_block(BLK0 + 1)[BY2BLK - 1] == 0);
+
+	KT_CHECK(bcache_flush() == 0);
+	KT_CHECK(disk_block(BLK0 + 1)[BY2BLK - 1] == 0xa5);
+	KT_CHECK(bcache_stats.bs_writebacks == s0.bs_writebacks + 1);
+}
+
+/* A dirty block pushed out by others is written back on the way. */
+static void
+test_lru(void)
+{
+	struct bcache_stats s0;
+	struct buf *b;
+	u_int i;
+
+	if (!KT_CHECK((b = bread(0, BLK0 + 2)) != NULL))
+		return;
+	b->b_data[0] = 0x3c;
+	bdirty(b);
+	brelse(b);
+
+	// every other block, so nothing is read ahead
+	s0 = bcache_stats;
+	for (i = 0; i < 2 * NBUF; i++)
+		if ((b = bread(0, i * 2)) != NULL)
+			brelse(b);
+	KT_CHECK(bcache_stats.bs_evictions >= s0.bs_evictions + NBUF);
+	KT_CHECK(disk_block(BLK0 + 2)[0] == 0x3c);
+
+	s0 = bcache_stats;
+	if ((b = bread(0, BLK0 + 2)) != NULL)
+		brelse(b);
+	KT_CHECK(bcache_stats.bs_misses == s0.bs_misses + 1);
+}
+
+/* A dirty block that cannot be written back stays cached and dirty. */
+static void
+test_write_error(void)
+{
+	struct bcache_stats s0;
+	struct buf *b;
+	u_int i;
+
+	if (!KT_CHECK((b = bread(0, BLK0 + 3)) != NULL))
+		return;
+	b->b_data[0] = 0x77;
+	bdirty(b);
+	brelse(b);
+
+	host_disk_ro[0] = 1;
+	for (i = 0; i < 2 * NBUF; i++)
+		if ((b = bread(0, i * 2)) != NULL)
+			brelse(b);
+	host_disk_ro[0] = 0;
+	KT_CHECK(disk_block(BLK0 + 3)[0] == 0);
+
+	s0 = bcache_stats;
+	if (!KT_CHECK((b = bread(0, BLK0 + 3)) != NULL))
+		return;
+	KT_CHECK(bcache_stats.bs_hits == s0.bs_hits + 1);
+	KT_CHECK(b->b_data[0] == 0x77 && (b->b_flags & B_DIRTY));
+	brelse(b);
+
+	KT_CHECK(bcache_flush() == 0);
+	KT_CHECK(disk_block(BLK0 + 3)[0] == 0x77);
+}
+
+static void
+test_readahead(void)
+{
+	struct bcache_stats s0 = bcache_stats;
+	struct buf *b;
+	u_int i;
+
+	for (i = 0; i < 32; i++)
+		disk_block(BLK0 + 16 + i)[0] = i;
+	for (i = 0; i < 32; i++) {
+		if (!KT_CHECK((b = bread(0, BLK0 + 16 + i)) != NULL))
+			return;
+		KT_CHECK(b->b_data[0] == i);
+		brelse(b);
+	}
+	KT_CHECK(bcache_stats.bs_ra_issued > s0.bs_ra_issued);
+	KT_CHECK(bcache_stats.bs_ra_hits > s0.bs_ra_hits);
+	KT_CHECK(bcache_stats.bs_misses - s0.bs_misses < 8);
+}
+
+const struct ktest bcache_tests[] = {
+	{ "bcache/hit", test_hit },
+	{ "bcache/writeback", test_writeback },
+	{ "bcache/lru", test_lru },
+	{ "bcache/write_error", test_write_error },
+	{ "bcache/readahead", test_readahead },
+	{ NULL, NULL },
+};
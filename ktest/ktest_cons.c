@@ -0,0 +1,89 @@
+/*
+ * Console input tests: typed input arrives through the console
+ * interrupt and the line discipline, the kernel waits for it in
+ * sched_wait() instead of polling the device, and an env reading with
+ * nothing typed sleeps until the interrupt brings a line.
+ */
+
+#include <cons.h>
+#include <sched.h>
+#include <env.h>
+#include <smp.h>
+#include <asm/cp0regdef.h>
+#include "../test.h"
+#include "ktest.h"
+
+static char echo[64];
+static int necho;
+
+static void
+echo_putchar(char ch)
+{
+	if (necho < sizeof(echo) - 1)
+		echo[necho++] = ch;
+}
+
+static int
+streq(const char *a, const char *b)
+{
+	while (*a && *a == *b)
+		a++, b++;
+	return *a == *b;
+}
+
+static void
+test_getchar(void)
+{
+	void (*putchar)(char) = host_putchar;
+
+	host_putchar = echo_putchar;
+	host_input = "ab\x7f" "c\r";
+	KT_CHECK(_getchar() == 'a');
+	KT_CHECK(*host_input == '\0');
+	KT_CHECK(_getchar() == 'c');
+	KT_CHECK(_getchar() == '\n');
+	KT_CHECK(mycpu()->cpu_wchan == NULL);
+	KT_CHECK(streq(echo, "ab\b \bc\n"));
+
+	// ^U takes back the whole line
+	host_input = "hello\x15" "bye\r";
+	KT_CHECK(streq(readline(NULL), "bye"));
+	host_putchar = putchar;
+	host_input = NULL;
+}
+
+static void
+test_read(void)
+{
+	void (*putchar)(char) = host_putchar;
+	struct Env *e;
+	char buf[8];
+
+	if (!KT_CHECK(env_take(&e, 0) == 0))
+		return;
+	e->env_cpu = 0;
+	sched_enqueue(e);
+	curenv = sched_pick();
+
+	KT_CHECK(cons_read(buf, sizeof(buf)) == 0);
+	KT_CHECK(e->env_status == ENV_NOT_RUNNABLE);
+	KT_CHECK(sched_pick() == NULL);
+
+	host_putchar = echo_putchar;
+	host_input = "x\r";
+	sched_intr(STATUSF_IP2);
+	host_putchar = putchar;
+	KT_CHECK(e->env_status == ENV_RUNNABLE);
+	KT_CHECK(sched_pick() == e);
+	KT_CHECK(cons_read(buf, sizeof(buf)) == 2);
+	KT_CHECK(buf[0] == 'x' && buf[1] == '\n');
+
+	curenv = NULL;
+	env_put(e);
+}
+
+const struct ktest cons_tests[] = {
+	{ "cons/getchar", test_getchar },
+	{ "cons/read", test_read },
+	{ NULL, NULL },
+};
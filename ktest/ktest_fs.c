@@ -0,0 +1,142 @@
+/*
+ * File system tests on the host RAM disk: a file written in order stays
+ * one extent, files growing side by side spill into the indirect extent
+ * block, and a directory grows table by table as names are added.
+ */
+
+#include <fs.h>
+#include <printf.h>
+#include <error.h>
+#include "ktest.h"
+
+#define FS_NBLOCKS	512		// below the blocks the bcache tests use
+
+static u_int blk[BY2BLK / 4];
+
+static void
+fill(u_int tag)
+{
+	u_int i;
+
+	for (i = 0; i < BY2BLK / 4; i++)
+		blk[i] = tag + i;
+}
+
+static int
+same(u_int tag)
+{
+	u_int i;
+
+	for (i = 0; i < BY2BLK / 4; i++)
+		if (blk[i] != tag + i)
+			return 0;
+	return 1;
+}
+
+static void
+test_format(void)
+{
+	struct Fnode fn;
+
+	KT_CHECK(fs_format(0, FS_NBLOCKS) == 0);
+	KT_CHECK(fs_mount(0) == 0);
+	KT_CHECK(file_open("/", &fn) == 0);
+	KT_CHECK(file_open("/none", &fn) == -E_NOT_FOUND);
+}
+
+static void
+test_sequential(void)
+{
+	struct Fnode fn;
+	u_int i;
+
+	if (!KT_CHECK(file_create("/seq", FTYPE_REG, &fn) == 0))
+		return;
+	for (i = 0; i < 12; i++) {
+		fill(i << 16);
+		KT_CHECK(file_write(&fn, blk, BY2BLK, i * BY2BLK) == BY2BLK);
+	}
+	KT_CHECK(fn.fn_file.f_size == 12 * BY2BLK);
+	KT_CHECK(fn.fn_file.f_nextent == 1);
+	KT_CHECK(fn.fn_file.f_extent[0].e_len == 12);
+
+	for (i = 0; i < 12; i++) {
+		KT_CHECK(file_read(&fn, blk, BY2BLK, i * BY2BLK) == BY2BLK);
+		KT_CHECK(same(i << 16));
+	}
+}
+
+/* Two files growing a block at a time take turns on the disk. */
+static void
+test_interleaved(void)
+{
+	struct Fnode a, b;
+	u_int i, n = NEXTENT + 4;
+
+	if (!KT_CHECK(file_create("/a", FTYPE_REG, &a) == 0) ||
+	    !KT_CHECK(file_create("/b", FTYPE_REG, &b) == 0))
+		return;
+	for (i = 0; i < n; i++) {
+		fill(0xa0000000 | i << 16);
+		KT_CHECK(file_write(&a, blk, BY2BLK, i * BY2BLK) == BY2BLK);
+		fill(0xb0000000 | i << 16);
+		KT_CHECK(file_write(&b, blk, BY2BLK, i * BY2BLK) == BY2BLK);
+	}
+	KT_CHECK(a.fn_file.f_nextent == n);
+	KT_CHECK(a.fn_file.f_indirect != 0);
+
+	// what is read goes through the extents on disk, not the Fnode
+	KT_CHECK(file_open("/a", &a) == 0);
+	for (i = 0; i < n; i++) {
+		KT_CHECK(file_read(&a, blk, BY2BLK, i * BY2BLK) == BY2BLK);
+		KT_CHECK(same(0xa0000000 | i << 16));
+	}
+	KT_CHECK(file_remove("/b") == 0);
+	KT_CHECK(file_remove("/a") == 0);
+}
+
+static void
+test_directory(void)
+{
+	struct Fnode dn, fn;
+	char path[32];
+	u_int i, nfail = 0;
+
+	if (!KT_CHECK(file_create("/d", FTYPE_DIR, &dn) == 0))
+		return;
+	for (i = 0; i < 200; i++) {
+		_snprintf(path, sizeof(path), "/d/f%d", i);
+		if (file_create(path, FTYPE_REG, &fn) < 0)
+			nfail++;
+	}
+	KT_CHECK(nfail == 0);
+	KT_CHECK(fs_sync() == 0);
+	KT_CHECK(fs_mount(0) == 0);
+
+	// 180 names fill four tables to 3/4, the rest go to a fifth
+	if (!KT_CHECK(file_open("/d", &dn) == 0))
+		return;
+	KT_CHECK(dn.fn_file.f_dirlive == 200);
+	KT_CHECK(dn.fn_file.f_size == (1 + 2 + 4 + 8 + 16) * BY2BLK);
+	for (i = 0; i < 200; i++) {
+		_snprintf(path, sizeof(path), "/d/f%d", i);
+		if (file_open(path, &fn) < 0)
+			nfail++;
+	}
+	KT_CHECK(nfail == 0);
+	KT_CHECK(file_open("/d/f200", &fn) == -E_NOT_FOUND);
+
+	KT_CHECK(file_remove("/d/f7") == 0);
+	KT_CHECK(file_open("/d/f7", &fn) == -E_NOT_FOUND);
+	KT_CHECK(file_open("/d/f8", &fn) == 0);
+	KT_CHECK(file_create("/d/f7", FTYPE_REG, &fn) == 0);
+	KT_CHECK(file_create("/d/f8", FTYPE_REG, &fn) == -E_FILE_EXISTS);
+}
+
+const struct ktest fs_tests[] = {
+	{ "fs/format", test_format },
+	{ "fs/sequential", test_sequential },
+	{ "fs/interleaved", test_interleaved },
+	{ "fs/directory", test_directory },
+	{ NULL, NULL },
+};
@@ -0,0 +1,75 @@
+/*
+ * Futex tests: two envs mapping one page at different addresses sleep
+ * on the same word, keyed by its physical address, and are woken in
+ * the order they went to sleep.
+ */
+
+#include <futex.h>
+#include <env.h>
+#include <pmap.h>
+#include <sched.h>
+#include <error.h>
+#include "../test.h"
+#include "ktest.h"
+
+#define VA_A	0x00400000
+#define VA_B	0x00c03000
+
+static struct Env a, b;
+
+static void
+run(struct Env *e)
+{
+	mycpu()->cpu_env = e;
+}
+
+static void
+test_wake(void)
+{
+	struct Page *pp;
+	u_int *word;
+
+	a.env_pgdir = host_pgtable();
+	b.env_pgdir = host_pgtable();
+	if (!KT_CHECK(a.env_pgdir != NULL && b.env_pgdir != NULL) ||
+	    !KT_CHECK(page_alloc(&pp) == 0) ||
+	    !KT_CHECK(page_insert(a.env_pgdir, pp, VA_A, PTE_R) == 0) ||
+	    !KT_CHECK(page_insert(b.env_pgdir, pp, VA_B, PTE_R) == 0))
+		return;
+	a.env_cpu = b.env_cpu = 0;
+	a.env_status = b.env_status = ENV_RUNNABLE;
+	word = (u_int *)(page2kva(pp) + 8);
+	*word = 1;
+
+	run(&a);
+	KT_CHECK(futex_wait(VA_A + 8, 0) == -E_AGAIN);
+	KT_CHECK(a.env_status == ENV_RUNNABLE);
+	KT_CHECK(futex_wait(VA_A + 9, 1) == -E_INVAL);
+	KT_CHECK(futex_wait(VA_A + BY2PG, 1) == -E_INVAL);
+	KT_CHECK(futex_wait(VA_A + 8, 1) == 0);
+	KT_CHECK(a.env_status == ENV_NOT_RUNNABLE);
+
+	run(&b);
+	KT_CHECK(futex_wait(VA_B + 8, 1) == 0);
+	KT_CHECK(b.env_status == ENV_NOT_RUNNABLE);
+
+	// another word of the page wakes nobody
+	KT_CHECK(futex_wake(VA_B + 4, 1) == 0);
+	KT_CHECK(futex_wake(VA_B + 8, 1) == 1);
+	KT_CHECK(a.env_status == ENV_RUNNABLE);
+	KT_CHECK(b.env_status == ENV_NOT_RUNNABLE);
+	KT_CHECK(futex_wake(VA_B + 8, 5) == 1);
+	KT_CHECK(b.env_status == ENV_RUNNABLE);
+	KT_CHECK(futex_wake(VA_B + 8, 5) == 0);
+
+	KT_CHECK(sched_pick() == &a);
+	KT_CHECK(sched_pick() == &b);
+	run(NULL);
+	page_remove(a.env_pgdir, VA_A);
+	page_remove(b.env_pgdir, VA_B);
+}
+
+const struct ktest futex_tests[] = {
+	{ "futex/wake", test_wake },
+	{ NULL, NULL },
+};
@@ -0,0 +1,152 @@
+/*
+ * Memory-mapped file tests: a fault maps the buffer cache page of the
+ * block itself, the first write marks it dirty, and unmapping writes it
+ * back to the file, even if it was flushed while mapped.  With every
+ * page in use, a fault takes one only from an env it can hold or from
+ * itself.
+ */
+
+#include <mmap.h>
+#include <env.h>
+#include <pmap.h>
+#include <pgrange.h>
+#include <sched.h>
+#include <error.h>
+#include "../test.h"
+#include "ktest.h"
+
+#define MAPVA	0x10000000
+
+static struct Env env;
+static u_int blk[BY2BLK / 4];
+
+static void
+test_fault(void)
+{
+	struct Fnode fn;
+	struct Page *pp;
+	Pte *pte;
+	u_int i;
+
+	env.env_pgdir = host_pgtable();
+	if (!KT_CHECK(env.env_pgdir != NULL) ||
+	    !KT_CHECK(fs_format(0, 64) == 0) || !KT_CHECK(fs_mount(0) == 0) ||
+	    !KT_CHECK(file_create("/m", FTYPE_REG, &fn) == 0))
+		return;
+	for (i = 0; i < 4; i++) {
+		blk[0] = i;
+		KT_CHECK(file_write(&fn, blk, BY2BLK, i * BY2BLK) == BY2BLK);
+	}
+	KT_CHECK(mmap_file(&env, MAPVA, 4 * BY2PG, &fn, 0, PTE_R) == 0);
+	KT_CHECK(mmap_file(&env, MAPVA + BY2PG, BY2PG, &fn, 0, 0) == -E_INVAL);
+
+	KT_CHECK(page_lookup(env.env_pgdir, MAPVA + 2 * BY2PG, NULL) == NULL);
+	KT_CHECK(mmap_fault(&env, MAPVA + 2 * BY2PG + 12, 0) == 0);
+	if (!KT_CHECK((pp = page_lookup(env.env_pgdir, MAPVA + 2 * BY2PG,
+					&pte)) != NULL))
+		return;
+	KT_CHECK(*(u_int *)page2kva(pp) == 2);
+	KT_CHECK(!(*pte & PTE_R));
+
+	KT_CHECK(mmap_fault(&env, MAPVA + 2 * BY2PG, 1) == 0);
+	KT_CHECK(*pte & PTE_R);
+	*(u_int *)page2kva(pp) = 0xdead;
+
+	KT_CHECK(mmap_fault(&env, MAPVA + 4 * BY2PG, 0) == -E_INVAL);
+	KT_CHECK(munmap_file(&env, MAPVA) == 0);
+	KT_CHECK(page_lookup(env.env_pgdir, MAPVA + 2 * BY2PG, NULL) == NULL);
+	KT_CHECK(mmap_fault(&env, MAPVA + 2 * BY2PG, 0) == -E_INVAL);
+
+	KT_CHECK(bcache_flush() == 0);
+	KT_CHECK(file_read(&fn, blk, BY2BLK, 2 * BY2BLK) == BY2BLK);
+	KT_CHECK(blk[0] == 0xdead);
+}
+
+/* Stores after a flush of the buffer still reach the file. */
+static void
+test_flush(void)
+{
+	struct Fnode fn;
+	struct Page *pp;
+	struct buf *b;
+
+	if (!KT_CHECK(file_open("/m", &fn) == 0) ||
+	    !KT_CHECK(mmap_file(&env, MAPVA, BY2PG, &fn, 0, PTE_R) == 0) ||
+	    !KT_CHECK(mmap_fault(&env, MAPVA, 1) == 0) ||
+	    !KT_CHECK((pp = page_lookup(env.env_pgdir, MAPVA, NULL)) != NULL))
+		return;
+	*(u_int *)page2kva(pp) = 0xbeef;
+	KT_CHECK(bcache_flush() == 0);
+
+	// still mapped writable: this store does not fault
+	*(u_int *)page2kva(pp) = 0xcafe;
+	KT_CHECK(munmap_file(&env, MAPVA) == 0);
+	KT_CHECK(bcache_flush() == 0);
+	if (!KT_CHECK(file_getblock(&fn, 0, &b) == 0))
+		return;
+	KT_CHECK(*(u_int *)host_disk[0][b->b_blockno * BLK2SECT] == 0xcafe);
+	brelse(b);
+}
+
+static u_int
+nmapped(struct Env *e, u_int npage)
+{
+	u_int i, n = 0;
+
+	for (i = 0; i < npage; i++)
+		if (page_lookup(e->env_pgdir, MAPVA + i * BY2PG, NULL))
+			n++;
+	return n;
+}
+
+static void
+test_evict(void)
+{
+	struct Env *a, *b;
+	struct Fnode fn;
+	u_int i, gen;
+
+	if (!KT_CHECK((a = host_env_new()) != NULL) ||
+	    !KT_CHECK((b = host_env_new()) != NULL) ||
+	    !KT_CHECK(file_create("/e", FTYPE_REG, &fn) == 0))
+		return;
+	for (i = 0; i < NVPAGE + 2; i++)
+		if (!KT_CHECK(file_write(&fn, blk, BY2BLK, i * BY2BLK) == BY2BLK))
+			return;
+	sched_enqueue(a);
+	KT_CHECK(mmap_file(a, MAPVA, NVPAGE * BY2PG, &fn, 0, 0) == 0);
+	KT_CHECK(mmap_file(b, MAPVA, 2 * BY2PG, &fn, NVPAGE * BY2PG, 0) == 0);
+	for (i = 0; i < NVPAGE; i++)
+		KT_CHECK(mmap_fault(a, MAPVA + i * BY2PG, 0) == 0);
+
+	// a is queued: held, its oldest page unmapped, TLBs shot down
+	gen = tlb_gen;
+	KT_CHECK(mmap_fault(b, MAPVA, 0) == 0);
+	KT_CHECK(page_lookup(a->env_pgdir, MAPVA, NULL) == NULL);
+	KT_CHECK(nmapped(a, NVPAGE) == NVPAGE - 1);
+	KT_CHECK(tlb_gen != gen);
+	KT_CHECK(a->env_held == 0 && a->env_sched_link.tqe_prev != NULL);
+
+	// a is running: b can only give up a page of its own
+	KT_CHECK(sched_dequeue(a) == 1);
+	KT_CHECK(mmap_fault(b, MAPVA + BY2PG, 0) == 0);
+	KT_CHECK(nmapped(a, NVPAGE) == NVPAGE - 1);
+	KT_CHECK(nmapped(b, 2) == 1);
+
+	// ... unless a thread shares b's space
+	pa2page(b->env_cr3)->pp_ref = 2;
+	KT_CHECK(mmap_fault(b, MAPVA, 0) == -E_NO_MEM);
+	pa2page(b->env_cr3)->pp_ref = 1;
+
+	KT_CHECK(munmap_file(a, MAPVA) == 0);
+	KT_CHECK(munmap_file(b, MAPVA) == 0);
+	env_put(a);
+	env_put(b);
+}
+
+const struct ktest mmap_tests[] = {
+	{ "mmap/fault", test_fault },
+	{ "mmap/flush", test_flush },
+	{ "mmap/evict", test_evict },
+	{ NULL, NULL },
+};
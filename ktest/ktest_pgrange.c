@@ -0,0 +1,77 @@
+/*
+ * Page table range tests: walking skips missing page tables a PDMAP at
+ * a time, and the pmap_*_range() calls share, protect, translate and
+ * drop pages across a page table boundary.
+ */
+
+#include <pgrange.h>
+#include <pmap.h>
+#include "../test.h"
+#include "ktest.h"
+
+#define SRCVA	(3 * PDMAP - 2 * BY2PG)	// 4 pages over a table boundary
+#define DSTVA	(8 * PDMAP - BY2PG)
+
+static void
+test_walk(void)
+{
+	struct pgrange pr;
+	struct Page *pp;
+	Pde *pgdir = host_pgtable();
+	u_int n = 0;
+
+	if (!KT_CHECK(pgdir != NULL) || !KT_CHECK(page_alloc(&pp) == 0) ||
+	    !KT_CHECK(page_insert(pgdir, pp, PDMAP + 5 * BY2PG, PTE_R) == 0))
+		return;
+
+	pgrange_init(&pr, pgdir, 0, 3 * PDMAP, 0);
+	while (pgrange_next(&pr) != NULL)
+		n++;
+	KT_CHECK(n == PDMAP / BY2PG);
+	KT_CHECK(pr.pr_error == 0);
+	page_remove(pgdir, PDMAP + 5 * BY2PG);
+}
+
+static void
+test_range(void)
+{
+	Pde *src = host_pgtable(), *dst = host_pgtable();
+	struct Page *pp[4];
+	u_long pa[5];
+	Pte *pte;
+	int i;
+
+	if (!KT_CHECK(src != NULL && dst != NULL))
+		return;
+	for (i = 0; i < 4; i++)
+		if (i != 2 && (!KT_CHECK(page_alloc(&pp[i]) == 0) ||
+			       !KT_CHECK(page_insert(src, pp[i], SRCVA + i * BY2PG,
+						     PTE_R) == 0)))
+			return;
+
+	KT_CHECK(pmap_map_range(dst, DSTVA, src, SRCVA, 4 * BY2PG,
+				PTE_R) == 0);
+	KT_CHECK(pp[0]->pp_ref == 2 && pp[3]->pp_ref == 2);
+	KT_CHECK(page_lookup(dst, DSTVA + 2 * BY2PG, NULL) == NULL);
+
+	pmap_translate_range(dst, DSTVA, 5, pa);
+	KT_CHECK(pa[0] == page2pa(pp[0]) && pa[1] == page2pa(pp[1]));
+	KT_CHECK(pa[2] == ~0UL && pa[3] == page2pa(pp[3]) && pa[4] == ~0UL);
+
+	pmap_protect_range(dst, DSTVA, 4 * BY2PG, 0);
+	KT_CHECK(page_lookup(dst, DSTVA + BY2PG, &pte) == pp[1]);
+	KT_CHECK(pte && !(*pte & PTE_R));
+	KT_CHECK(page_lookup(src, SRCVA + BY2PG, &pte) == pp[1]);
+	KT_CHECK(pte && (*pte & PTE_R));
+
+	pmap_unmap_range(dst, DSTVA, 4 * BY2PG);
+	KT_CHECK(pp[0]->pp_ref == 1 && pp[3]->pp_ref == 1);
+	KT_CHECK(page_lookup(dst, DSTVA, NULL) == NULL);
+	pmap_unmap_range(src, SRCVA, 4 * BY2PG);
+}
+
+const struct ktest pgrange_tests[] = {
+	{ "pgrange/walk", test_walk },
+	{ "pgrange/range", test_range },
+	{ NULL, NULL },
+};
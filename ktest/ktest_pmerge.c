@@ -0,0 +1,135 @@
+/*
+ * Same-page merging tests: equal pages of three envs become one merged
+ * page, a write splits it again, a scan that merges nothing shoots no
+ * TLB down, and a held env destroyed meanwhile is not queued again.
+ */
+
+#include <pmerge.h>
+#include <pmap.h>
+#include <env.h>
+#include <pgrange.h>
+#include <sched.h>
+#include <error.h>
+#include "../test.h"
+#include "ktest.h"
+
+#define NPMENV	3
+#define PMVA	0x00400000
+
+static struct Env *pmenv[NPMENV];
+
+/* Pages 0 and 1 hold the same in every env, pages 2 and 3 do not. */
+static void
+test_merge(void)
+{
+	struct Page *pp;
+	u_int i, j, nfreed = pmerge_nfreed, gen;
+	Pte pte;
+
+	for (i = 0; i < NPMENV; i++) {
+		if (!KT_CHECK((pmenv[i] = host_env_new()) != NULL))
+			return;
+		sched_enqueue(pmenv[i]);
+		for (j = 0; j < 4; j++) {
+			if (!KT_CHECK(page_alloc(&pp) == 0) ||
+			    !KT_CHECK(page_insert(pmenv[i]->env_pgdir, pp,
+						  PMVA + j * BY2PG, PTE_R) == 0))
+				return;
+			*(u_int *)page2kva(pp) = j < 2 ? j + 1 : (i + 1) << 8 | j;
+		}
+	}
+
+	gen = tlb_gen;
+	pmerge_scan(NPMENV * PDMAP / BY2PG);
+	KT_CHECK(pmerge_nfreed == nfreed + 2 * (NPMENV - 1));
+	KT_CHECK(tlb_gen != gen);
+	for (j = 0; j < 2; j++) {
+		pte = *host_pte(pmenv[0], PMVA + j * BY2PG);
+		pp = pa2page(pte);
+		KT_CHECK((pte & (PTE_MERGED | PTE_R)) == PTE_MERGED);
+		KT_CHECK((pp->pp_flags & PP_MERGED) && pp->pp_ref == NPMENV);
+		for (i = 1; i < NPMENV; i++)
+			KT_CHECK(PTE_ADDR(*host_pte(pmenv[i],
+						    PMVA + j * BY2PG)) ==
+				 PTE_ADDR(pte));
+	}
+	for (i = 0; i < NPMENV; i++) {
+		KT_CHECK(*host_pte(pmenv[i], PMVA + 2 * BY2PG) & PTE_R);
+		KT_CHECK(pmenv[i]->env_held == 0);
+	}
+
+	// nothing more to merge: no TLB is flushed for nothing
+	gen = tlb_gen;
+	pmerge_scan(NPMENV * PDMAP / BY2PG);
+	KT_CHECK(pmerge_nfreed == nfreed + 2 * (NPMENV - 1));
+	KT_CHECK(tlb_gen == gen);
+}
+
+static void
+test_split(void)
+{
+	struct Page *merged, *pp;
+	Pte pte;
+	u_int i;
+
+	if (pmenv[NPMENV - 1] == NULL)
+		return;
+	merged = pa2page(*host_pte(pmenv[0], PMVA));
+
+	KT_CHECK(pmerge_fault(pmenv[1]->env_pgdir, PMVA) == 0);
+	pte = *host_pte(pmenv[1], PMVA);
+	pp = pa2page(pte);
+	KT_CHECK(pp != merged && (pte & PTE_R) && !(pte & PTE_MERGED));
+	KT_CHECK(*(u_int *)page2kva(pp) == 1);
+	KT_CHECK(merged->pp_ref == NPMENV - 1);
+
+	for (i = 0; i < NPMENV; i++)
+		if (i != 1)
+			KT_CHECK(pmerge_fault(pmenv[i]->env_pgdir, PMVA) == 0);
+	// the last one keeps the page itself, private again
+	KT_CHECK(merged->pp_ref == 1 && !(merged->pp_flags & PP_MERGED));
+	KT_CHECK(pa2page(*host_pte(pmenv[NPMENV - 1], PMVA)) == merged);
+	KT_CHECK(pmerge_fault(pmenv[0]->env_pgdir, PMVA) == -E_INVAL);
+	KT_CHECK(pmerge_fault(pmenv[0]->env_pgdir, PMVA + 2 * BY2PG) ==
+		 -E_INVAL);
+}
+
+/* env_destroy() ran while the env was held: it stays off the queue. */
+static void
+test_hold(void)
+{
+	struct Env *e;
+	u_int i;
+
+	while (sched_pick() != NULL)
+		;
+	for (i = 0; i < NPMENV; i++)
+		if (pmenv[i])
+			sched_enqueue(pmenv[i]);
+	if ((e = pmenv[0]) == NULL)
+		return;
+
+	KT_CHECK(sched_hold(e) == 1);
+	KT_CHECK(e->env_held);
+	KT_CHECK(sched_hold(e) == 0);
+	e->env_status = ENV_NOT_RUNNABLE;	// as sched_forget() leaves it
+	sched_release(e);
+	KT_CHECK(!e->env_held);
+	KT_CHECK(sched_pick() == pmenv[1]);
+	KT_CHECK(sched_pick() == pmenv[2]);
+	KT_CHECK(sched_pick() == NULL);
+
+	sched_forget(e);
+	for (i = 0; i < NPMENV; i++)
+		if (pmenv[i]) {
+			pmap_unmap_range(pmenv[i]->env_pgdir, PMVA, 4 * BY2PG);
+			env_put(pmenv[i]);
+		}
+}
+
+const struct ktest pmerge_tests[] = {
+	{ "pmerge/merge", test_merge },
+	{ "pmerge/split", test_split },
+	{ "pmerge/hold", test_hold },
+	{ NULL, NULL },
+};
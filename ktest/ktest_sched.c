@@ -0,0 +1,190 @@
+/*
+ * Scheduler tests: sched_yield() requeues a runnable curenv and runs the
+ * next env, leaves a sleeping one off the queues, steals from another
+ * cpu when its own queue is empty, and counts only real switches.  A
+ * clock tick samples the pc of curenv for the profiler.  The host
+ * env_run() returns, so every yield can be checked.
+ */
+
+#include <sched.h>
+#include <env.h>
+#include <smp.h>
+#include <kstats.h>
+#include <prof.h>
+#include <asm/cp0regdef.h>
+#include "../test.h"
+#include "ktest.h"
+
+static struct Env *
+env_new(void)
+{
+	struct Env *e;
+
+	if (!KT_CHECK(env_take(&e, 0) == 0))
+		return NULL;
+	e->env_cpu = 0;
+	sched_enqueue(e);
+	return e;
+}
+
+static void
+test_yield(void)
+{
+	static int chan;
+	struct cpu *c = mycpu();
+	struct Env *a, *b;
+	u_int ctxsw = kstats.ks_ctxsw, cpu_ctxsw = c->cpu_ctxsw;
+
+	if ((a = env_new()) == NULL || (b = env_new()) == NULL)
+		return;
+
+	curenv = NULL;
+	sched_yield();
+	KT_CHECK(curenv == a && a->env_runs == 1);
+	sched_yield();
+	KT_CHECK(curenv == b);
+	sched_yield();
+	KT_CHECK(curenv == a);
+	KT_CHECK(kstats.ks_ctxsw == ctxsw + 3);
+	KT_CHECK(c->cpu_ctxsw == cpu_ctxsw + 3);
+
+	// a sleeps: b runs, then b again, which is no switch
+	sched_sleep(&chan);
+	sched_yield();
+	KT_CHECK(curenv == b);
+	sched_yield();
+	KT_CHECK(curenv == b && b->env_runs == 3);
+	KT_CHECK(kstats.ks_ctxsw == ctxsw + 4);
+
+	sched_wakeup(&chan);
+	sched_intr(0);
+	KT_CHECK(curenv == b);
+	sched_intr(STATUSF_IP4);
+	KT_CHECK(curenv == a);
+
+	while (sched_pick() != NULL)
+		;
+	curenv = NULL;
+	env_put(a);
+	env_put(b);
+}
+
+/* cpu 0 has nothing queued: it runs what waits on cpu 1. */
+static void
+test_steal(void)
+{
+	struct Env *e;
+
+	if (!KT_CHECK(env_take(&e, 0) == 0))
+		return;
+	ncpu = 2;
+	e->env_cpu = 1;
+	sched_enqueue(e);
+	KT_CHECK(cpus[1].cpu_runq.rq_len == 1);
+
+	curenv = NULL;
+	sched_yield();
+	KT_CHECK(curenv == e && e->env_cpu == 0);
+	KT_CHECK(cpus[1].cpu_runq.rq_len == 0);
+	ncpu = 1;
+
+	curenv = NULL;
+	env_put(e);
+}
+
+/* A sleeper woken while held is queued when it is let go. */
+static void
+test_hold(void)
+{
+	static int chan;
+	struct Env *a;
+
+	if ((a = env_new()) == NULL)
+		return;
+	curenv = sched_pick();
+	sched_sleep(&chan);
+	curenv = NULL;
+
+	KT_CHECK(sched_hold(a) == 1);
+	KT_CHECK(sched_hold(a) == 0);
+	sched_wakeup(&chan);
+	KT_CHECK(a->env_status == ENV_RUNNABLE);
+	KT_CHECK(sched_pick() == NULL);
+	sched_release(a);
+	KT_CHECK(sched_pick() == a);
+
+	// destroyed in its sleep: off the sleep queue, never held again
+	curenv = a;
+	sched_sleep(&chan);
+	curenv = NULL;
+	sched_forget(a);
+	KT_CHECK(a->env_wchan == NULL);
+	KT_CHECK(sched_hold(a) == 0);
+	KT_CHECK(sched_wakeup_n(&chan, 1) == 0);
+	KT_CHECK(sched_pick() == NULL);
+	env_put(a);
+}
+
+static char out[256];
+static int nout;
+
+static void
+out_putchar(char ch)
+{
+	if (nout < sizeof(out) - 1)
+		out[nout++] = ch;
+}
+
+static int
+contains(const char *s, const char *sub)
+{
+	const char *p, *q;
+
+	for (; *s; s++) {
+		for (p = s, q = sub; *q && *p == *q; p++, q++)
+			;
+		if (*q == '\0')
+			return 1;
+	}
+	return 0;
+}
+
+static void
+test_tick(void)
+{
+	void (*putchar)(char) = host_putchar;
+	struct Env *a, *b;
+
+	if ((a = env_new()) == NULL || (b = env_new()) == NULL)
+		return;
+	curenv = NULL;
+	sched_yield();
+	a->env_tf.cp0_epc = 0x00400120;
+
+	prof_sample_start();
+	sched_intr(STATUSF_IP4);
+	KT_CHECK(curenv == b);
+	prof_sample_stop();
+	sched_intr(STATUSF_IP4);
+	KT_CHECK(curenv == a);
+
+	host_putchar = out_putchar;
+	prof_sample_dump();
+	host_putchar = putchar;
+	KT_CHECK(contains(out, "prof-samples begin 1 dropped 0\n"));
+	KT_CHECK(contains(out, "prof-sample 400120\n"));
+
+	while (sched_pick() != NULL)
+		;
+	curenv = NULL;
+	env_put(a);
+	env_put(b);
+}
+
+const struct ktest sched_tests[] = {
+	{ "sched/yield", test_yield },
+	{ "sched/steal", test_steal },
+	{ "sched/hold", test_hold },
+	{ "sched/tick", test_tick },
+	{ NULL, NULL },
+};
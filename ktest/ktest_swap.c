@@ -0,0 +1,176 @@
+/*
+ * Swap tests on the host RAM disk 1: the clock spares pages used since
+ * it last came by, writes the others out and frees them, a fault reads
+ * them back, page allocation swaps when memory runs out, and envs asleep
+ * are swapped too.
+ */
+
+#include <swap.h>
+#include <pmap.h>
+#include <env.h>
+#include <pgrange.h>
+#include <sched.h>
+#include <kstats.h>
+#include <error.h>
+#include "../test.h"
+#include "ktest.h"
+
+#define NSWENV	2
+#define NSWPAGE	8
+#define SWVA	0x00400000
+
+static struct Env *swenv[NSWENV];
+
+/* The number of pages of the test envs that are swapped out. */
+static u_int
+nswapped(void)
+{
+	u_int i, j, n = 0;
+
+	for (i = 0; i < NSWENV; i++)
+		for (j = 0; j < NSWPAGE; j++)
+			if (*host_pte(swenv[i], SWVA + j * BY2PG) & PTE_SWAP)
+				n++;
+	return n;
+}
+
+/* Half the pages of every env were used lately, half were not. */
+static void
+test_out(void)
+{
+	struct Page *pp;
+	u_int i, j, out = kstats.ks_swap_out, gen;
+	Pte *pte;
+
+	for (i = 0; i < NSWENV; i++) {
+		if (!KT_CHECK((swenv[i] = host_env_new()) != NULL))
+			return;
+		sched_enqueue(swenv[i]);
+		for (j = 0; j < NSWPAGE; j++) {
+			if (!KT_CHECK(page_alloc(&pp) == 0) ||
+			    !KT_CHECK(page_insert(swenv[i]->env_pgdir, pp,
+						  SWVA + j * BY2PG,
+						  PTE_R | (j < NSWPAGE / 2 ?
+							   PTE_A : 0)) == 0))
+				return;
+			*(u_int *)page2kva(pp) = i << 8 | j;
+		}
+	}
+
+	gen = tlb_gen;
+	KT_CHECK(swap_out(6) == 6);
+	KT_CHECK(kstats.ks_swap_out == out + 6);
+	KT_CHECK(nswapped() == 6);
+	KT_CHECK(tlb_gen != gen);
+
+	// a swapped-out page is on disk, in the slot its Pte names
+	for (i = 0; i < NSWENV; i++) {
+		KT_CHECK(swenv[i]->env_held == 0);
+		for (j = 0; j < NSWPAGE; j++) {
+			pte = host_pte(swenv[i], SWVA + j * BY2PG);
+			if (*pte & PTE_SWAP)
+				KT_CHECK(*(u_int *)host_disk[SWAP_DISKNO]
+					 [SWAP_SLOT2SECT(PTE_ADDR(*pte) >> PGSHIFT)] ==
+					 (i << 8 | j));
+		}
+	}
+
+	// PTE_A is gone from the pages passed: next time round they go
+	KT_CHECK(swap_out(NSWENV * NSWPAGE) == NSWENV * NSWPAGE - 6);
+	KT_CHECK(nswapped() == NSWENV * NSWPAGE);
+}
+
+static void
+test_in(void)
+{
+	u_int i, j, in = kstats.ks_swap_in;
+	Pte *pte;
+
+	if (swenv[NSWENV - 1] == NULL)
+		return;
+	for (i = 0; i < NSWENV; i++)
+		for (j = 0; j < NSWPAGE; j++) {
+			KT_CHECK(swap_fault(swenv[i]->env_pgdir,
+					    SWVA + j * BY2PG) == 0);
+			pte = host_pte(swenv[i], SWVA + j * BY2PG);
+			KT_CHECK((*pte & (PTE_V | PTE_A | PTE_R | PTE_SWAP)) ==
+				 (PTE_V | PTE_A | PTE_R));
+			KT_CHECK(*(u_int *)page2kva(pa2page(*pte)) ==
+				 (i << 8 | j));
+		}
+	KT_CHECK(kstats.ks_swap_in == in + NSWENV * NSWPAGE);
+	KT_CHECK(swap_fault(swenv[0]->env_pgdir, SWVA) == -E_INVAL);
+	KT_CHECK(swap_fault(swenv[0]->env_pgdir, SWVA + PDMAP) == -E_INVAL);
+}
+
+/* With no free page left, swap_page_alloc() makes room. */
+static void
+test_pressure(void)
+{
+	static struct Page *held[HOST_NPAGE];
+	struct Page *pp;
+	u_int n = 0, i;
+
+	if (swenv[NSWENV - 1] == NULL)
+		return;
+	while (n < HOST_NPAGE && page_alloc(&held[n]) == 0)
+		n++;
+	KT_CHECK(page_alloc(&pp) == -E_NO_MEM);
+	KT_CHECK(swap_page_alloc(&pp) == 0);
+	KT_CHECK(nswapped() > 0);
+	page_free(pp);
+	while (n > 0)
+		page_free(held[--n]);
+
+	for (i = 0; i < NSWENV; i++)
+		swap_discard(swenv[i]->env_pgdir, SWVA, NSWPAGE * BY2PG);
+	KT_CHECK(nswapped() == 0);
+
+	while (sched_pick() != NULL)
+		;
+	for (i = 0; i < NSWENV; i++) {
+		pmap_unmap_range(swenv[i]->env_pgdir, SWVA, NSWPAGE * BY2PG);
+		env_put(swenv[i]);
+	}
+}
+
+/* An env asleep holds the coldest pages of all: they go too. */
+static void
+test_asleep(void)
+{
+	static int chan;
+	struct Page *pp;
+	struct Env *e;
+	u_int j;
+
+	if (!KT_CHECK((e = host_env_new()) != NULL))
+		return;
+	sched_enqueue(e);
+	for (j = 0; j < 2; j++)
+		if (!KT_CHECK(page_alloc(&pp) == 0) ||
+		    !KT_CHECK(page_insert(e->env_pgdir, pp, SWVA + j * BY2PG,
+					  PTE_R) == 0))
+			return;
+	curenv = sched_pick();
+	sched_sleep(&chan);
+	curenv = NULL;
+
+	KT_CHECK(swap_out(2) == 2);
+	KT_CHECK(*host_pte(e, SWVA) & PTE_SWAP);
+	KT_CHECK(*host_pte(e, SWVA + BY2PG) & PTE_SWAP);
+	KT_CHECK(e->env_held == 0 && e->env_wchan == &chan);
+	KT_CHECK(sched_pick() == NULL);
+
+	sched_forget(e);
+	swap_discard(e->env_pgdir, SWVA, 2 * BY2PG);
+	pmap_unmap_range(e->env_pgdir, SWVA, 2 * BY2PG);
+	env_put(e);
+}
+
+const struct ktest swap_tests[] = {
+	{ "swap/out", test_out },
+	{ "swap/in", test_in },
+	{ "swap/pressure", test_pressure },
+	{ "swap/asleep", test_asleep },
+	{ NULL, NULL },
+};
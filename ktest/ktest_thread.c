@@ -0,0 +1,102 @@
+/*
+ * Thread tests: a thread shares its leader's page directory and ASID,
+ * gets a stack slot of its own, and dropping it unmaps only that slot
+ * and shoots the stale TLB entries down.
+ */
+
+#include <thread.h>
+#include <pmap.h>
+#include <pgrange.h>
+#include <sched.h>
+#include <error.h>
+#include "../test.h"
+#include "ktest.h"
+
+static struct Env *
+leader_new(void)
+{
+	struct Env *e;
+
+	if (!KT_CHECK((e = host_env_new()) != NULL))
+		return NULL;
+	e->env_asid = 5;
+	e->env_pgfault_handler = 0x00401000;
+	e->env_tf.cp0_status = 0x1001;
+	return e;
+}
+
+static void
+test_create(void)
+{
+	struct Env *l, *t;
+	struct cpu *c = mycpu();
+	u_long top;
+	u_int gen;
+
+	if ((l = leader_new()) == NULL ||
+	    !KT_CHECK(thread_create(&t, l, 0x00400100, 42) == 0))
+		return;
+	top = THREAD_STACKTOP(t->env_id);
+	KT_CHECK(t->env_parent_id == l->env_id);
+	KT_CHECK(t->env_pgdir == l->env_pgdir && t->env_asid == 5);
+	KT_CHECK(pa2page(l->env_cr3)->pp_ref == 2);
+	KT_CHECK(t->env_status == ENV_RUNNABLE);
+	KT_CHECK(t->env_tf.regs[29] == top && t->env_tf.regs[4] == 42);
+	KT_CHECK(t->env_tf.cp0_epc == 0x00400100);
+	KT_CHECK(t->env_tf.cp0_status == 0x1001);
+	KT_CHECK(page_lookup(l->env_pgdir, top - BY2PG, NULL) != NULL);
+	KT_CHECK(page_lookup(l->env_pgdir, top - 2 * BY2PG, NULL) == NULL);
+	KT_CHECK(page_lookup(l->env_pgdir, top - THREAD_STKSIZE, NULL) != NULL);
+	KT_CHECK(t->env_xstacktop == top - THREAD_STKSIZE + BY2PG);
+	KT_CHECK(sched_pick() == t);
+
+	// one space: switching between the two loads nothing
+	c->cpu_cr3 = 0;
+	KT_CHECK(thread_loadspace(c, l) == 1);
+	KT_CHECK(thread_loadspace(c, t) == 0);
+
+	gen = tlb_gen;
+	KT_CHECK(thread_put_space(t) == 0);
+	KT_CHECK(tlb_gen == gen + 1);
+	KT_CHECK(pa2page(l->env_cr3)->pp_ref == 1);
+	KT_CHECK(page_lookup(l->env_pgdir, top - BY2PG, NULL) == NULL);
+	KT_CHECK(page_lookup(l->env_pgdir, top - THREAD_STKSIZE, NULL) == NULL);
+	env_put(t);
+
+	KT_CHECK(thread_put_space(l) == 1);
+	KT_CHECK(c->cpu_cr3 == 0);
+	env_put(l);
+}
+
+/* Without memory for the stack, the env goes back unused. */
+static void
+test_nomem(void)
+{
+	static struct Page *held[HOST_NPAGE];
+	struct Env *l, *t, *e;
+	u_int n = 0, envx;
+
+	if ((l = leader_new()) == NULL)
+		return;
+	if (!KT_CHECK(env_take(&e, 0) == 0))
+		return;
+	envx = ENVX(e->env_id);
+	env_put(e);
+
+	while (n < HOST_NPAGE && page_alloc(&held[n]) == 0)
+		n++;
+	KT_CHECK(thread_create(&t, l, 0x00400100, 0) == -E_NO_MEM);
+	while (n > 0)
+		page_free(held[--n]);
+
+	KT_CHECK(pa2page(l->env_cr3)->pp_ref == 1);
+	KT_CHECK(env_take(&e, 0) == 0 && ENVX(e->env_id) == envx);
+	env_put(e);
+	env_put(l);
+}
+
+const struct ktest thread_tests[] = {
+	{ "thread/create", test_create },
+	{ "thread/nomem", test_nomem },
+	{ NULL, NULL },
+};
@@ -0,0 +1,309 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <bcache.h>
+#include <pmap.h>
+#include <error.h>
+#include <spinlock.h>
+#include <printf.h>
+
+struct bcache_stats bcache_stats;
+
+static struct buf bufs[NBUF];
+LIST_HEAD(buf_list, buf);
+static struct buf_list bc_hash[BC_NHASH];
+TAILQ_HEAD(buf_tailq, buf);
+static struct buf_tailq bc_lru;
+
+/*
+ * Held across the disk I/O too: the device is synchronous anyway (see
+ * disk.h), and it keeps the buffer states simple.
+ */
+static struct spinlock bc_lock = SPINLOCK_INITIALIZER("bcache");
+
+/* per-disk sequential access detection */
+static struct {
+	u_int ra_next;			// block a sequential reader asks for next
+	u_int ra_run;			// consecutive blocks asked for so far
+	u_int ra_window;		// blocks to read ahead, 0 until sequential
+	u_int ra_end;			// first block not yet read ahead
+} bc_ra[BC_NDISK];
+
+#define BC_HASH(d, b)	(&bc_hash[((b) ^ ((d) << 5)) & (BC_NHASH - 1)])
+
+/* Overview:
+ *	Back every buffer with a page.  Returns 0, or -E_NO_MEM.
+ */
+int
+bcache_init(void)
+{
+	struct Page *pp;
+	struct buf *b;
+	int r;
+
+	TAILQ_INIT(&bc_lru);
+	for (r = 0; r < BC_NHASH; r++)
+		LIST_INIT(&bc_hash[r]);
+
+	for (b = bufs; b < bufs + NBUF; b++) {
+		if ((r = page_alloc(&pp)) < 0)
+			return r;
+		pp->pp_ref++;
+		b->b_data = (u_char *)page2kva(pp);
+		b->b_flags = 0;
+		b->b_ref = 0;
+		TAILQ_INSERT_TAIL(&bc_lru, b, b_lru);
+	}
+	return 0;
+}
+
+static void
+bc_start(struct buf *b, int write)
+{
+	struct disk_req *r = &b->b_req;
+
+	r->dr_diskno = b->b_diskno;
+	r->dr_secno = b->b_blockno * BLK2SECT;
+	r->dr_write = write;
+	r->dr_niov = 1;
+	r->dr_iov[0].iov_base = b->b_data;
+	r->dr_iov[0].iov_nsecs = BLK2SECT;
+	b->b_flags |= B_IO;
+	if (write) {
+		b->b_flags &= ~B_DIRTY;
+		bcache_stats.bs_writebacks++;
+	}
+	disk_submit(r);
+}
+
+/* Overview:
+ *	Finish the I/O in flight on b.  A failed read leaves b invalid; a
+ *	failed write leaves it dirty.  Returns 0 or -E_IO.
+ */
+static int
+bc_wait(struct buf *b)
+{
+	int r;
+
+	if (!(b->b_flags & B_IO))
+		return 0;
+	r = disk_wait(&b->b_req);
+	b->b_flags &= ~B_IO;
+	if (r < 0) {
+		if (b->b_req.dr_write) {
+			b->b_flags |= B_DIRTY;
+		} else {
+			LIST_REMOVE(b, b_hash);
+			b->b_flags = 0;
+		}
+	}
+	return r;
+}
+
+static struct buf *
+bc_lookup(int diskno, u_int blockno)
+{
+	struct buf *b;
+
+	LIST_FOREACH(b, BC_HASH(diskno, blockno), b_hash)
+		if (b->b_diskno == diskno && b->b_blockno == blockno)
+			return b;
+	return NULL;
+}
+
+/* Overview:
+ *	Take the least recently used unreferenced buffer and make it name
+ *	(diskno, blockno), writing back what it held first if need be.  A
+ *	buffer that cannot be written back keeps its block.  Returns NULL
+ *	if every buffer is in use or dirty and unwritable.
+ */
+static struct buf *
+bc_recycle(int diskno, u_int blockno)
+{
+	struct buf *b;
+
+	for (b = bc_lru.tqh_first; b; b = b->b_lru.tqe_next) {
+		if (b->b_ref != 0)
+			continue;
+		bc_wait(b);
+		if (b->b_flags & B_DIRTY) {
+			bc_start(b, 1);
+			bc_wait(b);
+		}
+		// a failed write leaves b dirty, see bc_wait()
+		if (!(b->b_flags & B_DIRTY))
+			break;
+	}
+	if (b == NULL)
+		return NULL;
+
+	if (b->b_flags & B_VALID) {
+		LIST_REMOVE(b, b_hash);
+		bcache_stats.bs_evictions++;
+		if (b->b_flags & B_RA)
+			bcache_stats.bs_ra_wasted++;
+	}
+
+	b->b_diskno = diskno;
+	b->b_blockno = blockno;
+	b->b_flags = B_VALID;
+	LIST_INSERT_HEAD(BC_HASH(diskno, blockno), b, b_hash);
+	TAILQ_REMOVE(&bc_lru, b, b_lru);
+	TAILQ_INSERT_TAIL(&bc_lru, b, b_lru);
+	return b;
+}
+
+/* Overview:
+ *	Queue reads of the blocks in [from, to) that are not cached, as
+ *	long as there are buffers to spare.  They are waited for later.
+ */
+static void
+bc_readahead(int diskno, u_int from, u_int to)
+{
+	struct buf *b;
+
+	for (; from < to; from++) {
+		if (bc_lookup(diskno, from) != NULL)
+			continue;
+		if ((b = bc_recycle(diskno, from)) == NULL)
+			return;
+		b->b_flags |= B_RA;
+		bc_start(b, 0);
+		bcache_stats.bs_ra_issued++;
+	}
+}
+
+/* Overview:
+ *	Note that blockno was asked for and read ahead if the disk is
+ *	being read sequentially.
+ */
+static void
+bc_sequential(int diskno, u_int blockno)
+{
+	typeof(bc_ra[0]) *ra = &bc_ra[diskno];
+
+	if (diskno >= BC_NDISK)
+		return;
+
+	if (blockno == ra->ra_next) {
+		ra->ra_run++;
+	} else {
+		ra->ra_run = 1;
+		ra->ra_window = 0;
+		ra->ra_end = blockno + 1;
+	}
+	ra->ra_next = blockno + 1;
+
+	if (ra->ra_run < 2)
+		return;
+
+	// start the next window once the reader is into the current one
+	if (ra->ra_end <= blockno + ra->ra_window / 2) {
+		ra->ra_window = ra->ra_window ? ra->ra_window * 2 : 2;
+		if (ra->ra_window > BC_RAMAX)
+			ra->ra_window = BC_RAMAX;
+		if (ra->ra_end < blockno + 1)
+			ra->ra_end = blockno + 1;
+		bc_readahead(diskno, ra->ra_end, blockno + 1 + ra->ra_window);
+		ra->ra_end = blockno + 1 + ra->ra_window;
+	}
+}
+
+/* Overview:
+ *	Return a referenced buffer holding block blockno of disk diskno,
+ *	or NULL if it could not be read or no buffer is free.
+ */
+struct buf *
+bread(int diskno, u_int blockno)
+{
+	struct buf *b;
+
+	spin_lock(&bc_lock);
+
+	if ((b = bc_lookup(diskno, blockno)) != NULL) {
+		bcache_stats.bs_hits++;
+		if (b->b_flags & B_RA) {
+			bcache_stats.bs_ra_hits++;
+			b->b_flags &= ~B_RA;
+		}
+		if (bc_wait(b) < 0 && !(b->b_flags & B_VALID))
+			b = NULL;
+	} else if ((b = bc_recycle(diskno, blockno)) != NULL) {
+		bcache_stats.bs_misses++;
+		bc_start(b, 0);
+		if (bc_wait(b) < 0)
+			b = NULL;
+	}
+
+	if (b != NULL) {
+		b->b_ref++;
+		TAILQ_REMOVE(&bc_lru, b, b_lru);
+		TAILQ_INSERT_TAIL(&bc_lru, b, b_lru);
+	}
+
+	bc_sequential(diskno, blockno);
+
+	spin_unlock(&bc_lock);
+	return b;
+}
+
+void
+brelse(struct buf *b)
+{
+	spin_lock(&bc_lock);
+	b->b_ref--;
+	spin_unlock(&bc_lock);
+}
+
+void
+bdirty(struct buf *b)
+{
+	spin_lock(&bc_lock);
+	b->b_flags |= B_DIRTY;
+	spin_unlock(&bc_lock);
+}
+
+/* Overview:
+ *	Start writing b back now; the write finishes on its own.
+ */
+void
+bawrite(struct buf *b)
+{
+	spin_lock(&bc_lock);
+	if ((b->b_flags & (B_DIRTY | B_IO)) == B_DIRTY)
+		bc_start(b, 1);
+	spin_unlock(&bc_lock);
+}
+
+/* Overview:
+ *	Write every dirty block back and wait for it.  The writes go to the
+ *	disk queue together, so the elevator can merge neighbours.
+ *	Returns 0, or -E_IO if any of them failed.
+ */
+int
+bcache_flush(void)
+{
+	struct buf *b;
+	int r = 0;
+
+	spin_lock(&bc_lock);
+	for (b = bufs; b < bufs + NBUF; b++)
+		if ((b->b_flags & (B_DIRTY | B_IO)) == B_DIRTY)
+			bc_start(b, 1);
+	for (b = bufs; b < bufs + NBUF; b++)
+		if (bc_wait(b) < 0 && (b->b_flags & B_DIRTY))
+			r = -E_IO;
+	spin_unlock(&bc_lock);
+	return r;
+}
+
+void
+bcache_dump(void)
+{
+	struct bcache_stats *s = &bcache_stats;
+
+	printf("bcache: %d bufs, hits %u misses %u evictions %u writebacks %u\n",
+		   NBUF, s->bs_hits, s->bs_misses, s->bs_evictions,
+		   s->bs_writebacks);
+	printf("bcache: read-ahead %u, used %u, wasted %u\n",
+		   s->bs_ra_issued, s->bs_ra_hits, s->bs_ra_wasted);
+}
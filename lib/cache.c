@@ -0,0 +1,87 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <cache.h>
+
+#define KSEG0	0x80000000
+
+struct cache_info icache, dcache;
+
+#define cache_op(op, va)					\
+	asm volatile(".set push\n\t.set mips32\n\t"		\
+		     "cache %0, 0(%1)\n\t.set pop"		\
+		     : : "i"(op), "r"(va))
+
+static void
+cache_probe(struct cache_info *ci, u_int sets, u_int line, u_int assoc)
+{
+	if (line == 0)
+		return;
+
+	ci->ci_linesz = 2 << line;
+	ci->ci_ways = assoc + 1;
+	ci->ci_size = (64 << sets) * ci->ci_linesz * ci->ci_ways;
+}
+
+/* Overview:
+ *	Size both primary caches from Config1 and invalidate every line by
+ *	storing a zero tag through the index operations.  Must run while
+ *	kseg0 is still uncached: the cache contents are garbage at reset.
+ */
+void
+cache_init(void)
+{
+	u_int config1;
+	u_long va;
+
+	asm volatile("mfc0 %0, $16, 1" : "=r"(config1));
+	cache_probe(&icache, (config1 >> 22) & 7, (config1 >> 19) & 7,
+				(config1 >> 16) & 7);
+	cache_probe(&dcache, (config1 >> 13) & 7, (config1 >> 10) & 7,
+				(config1 >> 7) & 7);
+
+	// TagLo = TagHi = 0: invalid, unlocked
+	asm volatile("mtc0 $0, $28\n\tmtc0 $0, $29\n\tnop\n\tnop\n\tnop");
+
+	for (va = KSEG0; va < KSEG0 + icache.ci_size; va += icache.ci_linesz)
+		cache_op(Index_Store_Tag_I, va);
+	for (va = KSEG0; va < KSEG0 + dcache.ci_size; va += dcache.ci_linesz)
+		cache_op(Index_Store_Tag_D, va);
+}
+
+/* Overview:
+ *	Write back and invalidate the data cache lines covering
+ *	[va, va + len), so memory holds what was written through kseg0.
+ */
+void
+cache_flush_range(u_long va, u_long len)
+{
+	u_long end = va + len;
+
+	if (dcache.ci_size == 0 || len == 0)
+		return;
+
+	for (va &= ~(dcache.ci_linesz - 1); va < end; va += dcache.ci_linesz)
+		cache_op(Hit_Writeback_Inv_D, va);
+	asm volatile(".set push\n\t.set mips2\n\tsync\n\t.set pop");
+}
+
+/* Overview:
+ *	Make instructions just written to [va, va + len) visible to
+ *	instruction fetch: push them out of the data cache, then drop any
+ *	stale copies from the instruction cache.
+ */
+void
+icache_sync(u_long va, u_long len)
+{
+	u_long end = va + len;
+
+	cache_flush_range(va, len);
+
+	if (icache.ci_size == 0 || len == 0)
+		return;
+
+	for (va &= ~(icache.ci_linesz - 1); va < end; va += icache.ci_linesz)
+		cache_op(Hit_Invalidate_I, va);
+	// let the pipeline drain before anybody jumps into the new code
+	asm volatile("nop\n\tnop\n\tnop\n\tnop\n\tnop");
+}
@@ -0,0 +1,271 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <cons.h>
+#include <atomic.h>
+#include <cache.h>
+#include <env.h>
+#include <sched.h>
+#include <spinlock.h>
+#include <printf.h>
+
+void printcharc(char ch);
+int scancharc(void);
+
+#define C(x)	((x) - '@')	// control-x
+
+/* r <= w <= e, all counting up forever; index buf modulo CONS_BUFSZ */
+static struct {
+	struct spinlock lock;
+	char buf[CONS_BUFSZ];
+	u_int r;			// next char to hand out
+	u_int w;			// end of the lines handed to readers
+	u_int e;			// end of the line being edited
+} cons = { SPINLOCK_INITIALIZER("cons") };
+
+/*
+ * A producer claims n slots by moving head forward, fills them, and
+ * marks each one full; the drainer writes out full slots from tail on
+ * and stops at the first one that is still being filled.
+ */
+static struct {
+	// producers and the drainer write these from different cpus
+	volatile u_int head;		// next slot to claim
+	volatile int async;		// queue instead of writing
+	volatile u_int tail __attribute__((aligned(CACHE_LINE)));
+					// next slot to write out
+	struct spinlock drain;		// held by the one drainer
+	volatile u_short slot[CONS_TXSZ] __attribute__((aligned(CACHE_LINE)));
+					// TX_FULL | char, or 0
+} tx __cacheline_aligned = { .drain = SPINLOCK_INITIALIZER("cons_tx") };
+
+#define TX_FULL		0x100
+
+static void
+cons_tx_put(const char *s, int n)
+{
+	u_int h;
+	int i;
+
+	// claim slots only after seeing room for them
+	for (;;) {
+		h = tx.head;
+		if (h + n - tx.tail > CONS_TXSZ)
+			cons_tx_drain();
+		else if (atomic_cmpxchg(&tx.head, h, h + n))
+			break;
+	}
+
+	for (i = 0; i < n; i++)
+		tx.slot[(h + i) % CONS_TXSZ] = TX_FULL | (u_char)s[i];
+}
+
+static void
+cons_tx_drain_locked(void)
+{
+	u_int t = tx.tail;
+	u_int c;
+
+	while ((c = tx.slot[t % CONS_TXSZ]) != 0) {
+		printcharc(c);
+		tx.slot[t++ % CONS_TXSZ] = 0;
+	}
+
+	// the slots must read empty before producers may claim them
+	mb();
+	tx.tail = t;
+}
+
+/* Overview:
+ *	Write out what is in the ring, unless another cpu already is.
+ */
+void
+cons_tx_drain(void)
+{
+	if (!spin_trylock(&tx.drain))
+		return;
+	cons_tx_drain_locked();
+	spin_unlock(&tx.drain);
+}
+
+/* Overview:
+ *	Wait for the drainer, if any, and empty the ring.
+ */
+void
+cons_tx_flush(void)
+{
+	spin_lock(&tx.drain);
+	cons_tx_drain_locked();
+	spin_unlock(&tx.drain);
+}
+
+void
+cons_tx_start(void)
+{
+	tx.async = 1;
+}
+
+/* Overview:
+ *	Write synchronously from now on.  Does not wait for the drainer:
+ *	panic may come from inside it.
+ */
+void
+cons_tx_sync(void)
+{
+	tx.async = 0;
+	smp_mb();
+	cons_tx_drain();
+}
+
+void
+cons_write(const char *s, int n)
+{
+	int chunk;
+
+	if (!tx.async) {
+		while (n-- > 0)
+			printcharc(*s++);
+		return;
+	}
+
+	for (; n > 0; s += chunk, n -= chunk) {
+		chunk = n < CONS_TXSZ / 4 ? n : CONS_TXSZ / 4;
+		cons_tx_put(s, chunk);
+	}
+}
+
+static void
+cons_erase(void)
+{
+	cons.e--;
+	cons_write("\b \b", 3);
+}
+
+/* Overview:
+ *	Feed one input char through the line discipline.  Returns 1 if it
+ *	completed a line for the readers, 0 otherwise.
+ */
+static int
+cons_input(int c)
+{
+	switch (c) {
+	case '\b':
+	case 0x7f:
+		if (cons.e != cons.w)
+			cons_erase();
+		return 0;
+	case C('U'):
+		while (cons.e != cons.w)
+			cons_erase();
+		return 0;
+	case '\r':
+		c = '\n';
+		break;
+	}
+
+	// a full buffer drops what is typed until somebody reads
+	if (cons.e - cons.r >= CONS_BUFSZ)
+		return 0;
+
+	cons.buf[cons.e++ % CONS_BUFSZ] = c;
+	cons_write(cons.buf + (cons.e - 1) % CONS_BUFSZ, 1);
+
+	if (c == '\n' || cons.e - cons.r == CONS_BUFSZ) {
+		cons.w = cons.e;
+		return 1;
+	}
+	return 0;
+}
+
+/* Overview:
+ *	The console interrupt: take every pending char from the device and
+ *	wake the envs sleeping in cons_read() if a line came in.
+ */
+void
+cons_intr(void)
+{
+	int c, done = 0;
+
+	spin_lock(&cons.lock);
+	while ((c = scancharc()) != 0)
+		done |= cons_input(c);
+	spin_unlock(&cons.lock);
+
+	if (done)
+		sched_wakeup(&cons);
+}
+
+/* Overview:
+ *	Return the next char of input, or -1 if no line is ready.
+ */
+int
+cons_getc(void)
+{
+	int c = -1;
+
+	spin_lock(&cons.lock);
+	if (cons.r != cons.w)
+		c = cons.buf[cons.r++ % CONS_BUFSZ];
+	spin_unlock(&cons.lock);
+	return c;
+}
+
+/* Overview:
+ *	Copy up to n chars of input, stopping after a newline, into buf and
+ *	return how many.  With no input, put curenv to sleep until a line
+ *	comes in and return 0: the system call then gives up the cpu and
+ *	the env tries again once it is woken.
+ */
+int
+cons_read(char *buf, int n)
+{
+	int i = 0;
+
+	spin_lock(&cons.lock);
+	if (cons.r == cons.w)
+		sched_sleep(&cons);
+
+	while (i < n && cons.r != cons.w) {
+		buf[i] = cons.buf[cons.r++ % CONS_BUFSZ];
+		if (buf[i++] == '\n')
+			break;
+	}
+	spin_unlock(&cons.lock);
+	return i;
+}
+
+/* Overview:
+ *	Return the next char of input, waiting for a line if there is none.
+ */
+int
+getchar(void)
+{
+	int c;
+
+	spin_lock(&cons.lock);
+	while (cons.r == cons.w)
+		sched_wait(&cons, &cons.lock);
+	c = cons.buf[cons.r++ % CONS_BUFSZ];
+	spin_unlock(&cons.lock);
+	return c;
+}
+
+/* Overview:
+ *	Print prompt, if any, and read a line into a static buffer.
+ *	Returns the line without its newline.
+ */
+char *
+readline(const char *prompt)
+{
+	static char buf[CONS_BUFSZ];
+	int i = 0;
+	int c;
+
+	if (prompt != NULL)
+		printf("%s", prompt);
+
+	while ((c = getchar()) != '\n')
+		if (i < CONS_BUFSZ - 1)
+			buf[i++] = c;
+	buf[i] = '\0';
+	return buf;
+}
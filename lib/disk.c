@@ -0,0 +1,184 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <disk.h>
+#include <error.h>
+#include <atomic.h>
+#include <sched.h>
+#include <spinlock.h>
+
+struct disk_stats disk_stats;
+
+TAILQ_HEAD(disk_reqq, disk_req);
+
+/* pending requests, sorted by (disk, sector) */
+static struct disk_reqq disk_queue = { NULL, &disk_queue.tqh_first };
+static struct spinlock disk_qlock = SPINLOCK_INITIALIZER("diskq");
+
+/* held by the cpu driving the device; where its last batch ended */
+static struct spinlock disk_lock = SPINLOCK_INITIALIZER("disk");
+static int disk_pos_disk;
+static u_int disk_pos_sec;
+
+/* is (d1, s1) below (d2, s2) in elevator order? */
+static int
+disk_below(int d1, u_int s1, int d2, u_int s2)
+{
+	return d1 < d2 || (d1 == d2 && s1 < s2);
+}
+
+/* Overview:
+ *	Queue r.  It is done when r->dr_done is set; see disk_wait().
+ */
+void
+disk_submit(struct disk_req *r)
+{
+	struct disk_req *q;
+	int i;
+
+	r->dr_nsecs = 0;
+	for (i = 0; i < r->dr_niov; i++)
+		r->dr_nsecs += r->dr_iov[i].iov_nsecs;
+	r->dr_done = 0;
+	r->dr_error = 0;
+
+	spin_lock(&disk_qlock);
+	// sequential submitters append, so try the tail first
+	q = disk_queue.tqh_first == NULL ? NULL :
+	    (struct disk_req *)((char *)disk_queue.tqh_last -
+				offsetof(struct disk_req, dr_link.tqe_next));
+	if (q != NULL && !disk_below(r->dr_diskno, r->dr_secno, q->dr_diskno,
+				     q->dr_secno))
+		q = NULL;
+	else
+		q = disk_queue.tqh_first;
+	for (; q; q = q->dr_link.tqe_next)
+		if (disk_below(r->dr_diskno, r->dr_secno, q->dr_diskno,
+			       q->dr_secno))
+			break;
+	if (q != NULL) {
+		TAILQ_INSERT_BEFORE(q, r, dr_link);
+	} else {
+		TAILQ_INSERT_TAIL(&disk_queue, r, dr_link);
+	}
+	disk_stats.ds_reqs++;
+	spin_unlock(&disk_qlock);
+}
+
+/* Overview:
+ *	Move the next batch off the queue into batch: the first request at
+ *	or above the last position (wrapping to the lowest), and every
+ *	request that continues it on disk in the same direction.
+ */
+static void
+disk_next_batch(struct disk_reqq *batch)
+{
+	struct disk_req *r, *next;
+
+	for (r = disk_queue.tqh_first; r; r = r->dr_link.tqe_next)
+		if (!disk_below(r->dr_diskno, r->dr_secno, disk_pos_disk,
+				disk_pos_sec))
+			break;
+	if (r == NULL)
+		r = disk_queue.tqh_first;
+
+	for (; r != NULL; r = next) {
+		next = r->dr_link.tqe_next;
+		TAILQ_REMOVE(&disk_queue, r, dr_link);
+		TAILQ_INSERT_TAIL(batch, r, dr_link);
+		if (next == NULL || next->dr_diskno != r->dr_diskno ||
+		    next->dr_write != r->dr_write ||
+		    next->dr_secno != r->dr_secno + r->dr_nsecs)
+			break;
+		disk_stats.ds_merged++;
+	}
+}
+
+static void
+disk_done(struct disk_req *r, int error)
+{
+	r->dr_error = error;
+	if (error)
+		disk_stats.ds_errors++;
+	else
+		disk_stats.ds_sectors += r->dr_nsecs;
+	smp_mb();
+	r->dr_done = 1;
+	sched_wakeup(r);
+}
+
+/* Overview:
+ *	Serve the queue until it is empty, unless another cpu already is.
+ */
+void
+disk_run(void)
+{
+	struct disk_reqq batch;
+	struct disk_req *r;
+	struct disk_iov *iov;
+	u_int secno;
+	int error;
+
+	if (!spin_trylock(&disk_lock))
+		return;
+
+	for (;;) {
+		TAILQ_INIT(&batch);
+		spin_lock(&disk_qlock);
+		disk_next_batch(&batch);
+		spin_unlock(&disk_qlock);
+
+		if (batch.tqh_first == NULL)
+			break;
+		disk_stats.ds_batches++;
+
+		while ((r = batch.tqh_first) != NULL) {
+			TAILQ_REMOVE(&batch, r, dr_link);
+			secno = r->dr_secno;
+			error = 0;
+			for (iov = r->dr_iov; iov < r->dr_iov + r->dr_niov; iov++) {
+				if (disk_xfer(r->dr_diskno, secno, iov->iov_base,
+					      iov->iov_nsecs, r->dr_write) < 0) {
+					error = -E_IO;
+					break;
+				}
+				secno += iov->iov_nsecs;
+			}
+			disk_pos_disk = r->dr_diskno;
+			disk_pos_sec = r->dr_secno + r->dr_nsecs;
+			disk_done(r, error);
+		}
+	}
+
+	spin_unlock(&disk_lock);
+}
+
+/* Overview:
+ *	Drive the queue until r is done.  Returns 0 or -E_IO.
+ */
+int
+disk_wait(struct disk_req *r)
+{
+	while (!r->dr_done)
+		disk_run();
+	return r->dr_error;
+}
+
+/* Overview:
+ *	Read (write != 0: write) nsecs sectors at secno into (from) buf and
+ *	wait for it.  Returns 0 or -E_IO.
+ */
+int
+disk_rw(int diskno, u_int secno, void *buf, u_int nsecs, int write)
+{
+	struct disk_req r;
+
+	r.dr_diskno = diskno;
+	r.dr_secno = secno;
+	r.dr_write = write;
+	r.dr_niov = 1;
+	r.dr_iov[0].iov_base = buf;
+	r.dr_iov[0].iov_nsecs = nsecs;
+
+	disk_submit(&r);
+	return disk_wait(&r);
+}
@@ -0,0 +1,743 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <fs.h>
+#include <mmu.h>
+#include <cache.h>
+#include <error.h>
+#include <spinlock.h>
+
+static int fs_diskno = -1;
+static u_int fs_nblocks;
+static u_int fs_nbitmap;
+static u_int fs_hint;			// where the last allocation ended
+
+static struct spinlock fs_lock = SPINLOCK_INITIALIZER("fs");
+
+#define SUPERBLOCK	1
+#define BITMAP		2
+#define BMAP_BLOCK(b)	(BITMAP + (b) / BIT2BLK)
+#define BMAP_BIT(b)	(0x80000000u >> ((b) % 32))
+
+/* Overview:
+ *	Count the leading zeros of w, which is not 0.  A MIPS32 cpu has an
+ *	instruction for it; the R3000 does not, and the same kernel runs on
+ *	both, so ask the cpu as tlb_flush_all() does.  The kernel is not
+ *	linked with libgcc's __clzsi2: elsewhere, halve the search five
+ *	times instead.
+ */
+static inline int
+clz32(u_int w)
+{
+	int n = 0;
+
+#ifndef __x86_64__
+	if (cpu_is_4kc()) {
+		asm(".set push\n\t.set mips32\n\t"
+		    "clz %0, %1\n\t.set pop" : "=r" (n) : "r" (w));
+		return n;
+	}
+#endif
+	if (!(w & 0xffff0000)) { n += 16; w <<= 16; }
+	if (!(w & 0xff000000)) { n += 8; w <<= 8; }
+	if (!(w & 0xf0000000)) { n += 4; w <<= 4; }
+	if (!(w & 0xc0000000)) { n += 2; w <<= 2; }
+	if (!(w & 0x80000000)) { n += 1; }
+	return n;
+}
+
+static struct buf *
+fs_bread(u_int blockno)
+{
+	return bread(fs_diskno, blockno);
+}
+
+/* Overview:
+ *	Take a free block, the first at or after goal, wrapping around to
+ *	the start of the disk.  Returns 0 with it in *pblockno, or -E_NO_DISK.
+ */
+static int
+bitmap_alloc(u_int goal, u_int *pblockno)
+{
+	struct buf *bp;
+	u_int *map, w, i, n, bm;
+
+	if (goal >= fs_nblocks)
+		goal = 0;
+	bm = goal / BIT2BLK;
+	i = (goal % BIT2BLK) / 32;
+	w = ~0u >> (goal % 32);
+
+	// the first bitmap block is visited twice, for the words before goal
+	for (n = 0; n <= fs_nbitmap; n++) {
+		if ((bp = fs_bread(BITMAP + bm)) == NULL)
+			return -E_IO;
+		map = (u_int *)bp->b_data;
+		for (; i < BY2BLK / 4; i++, w = ~0u) {
+			if ((w &= map[i]) == 0)
+				continue;
+			w = i * 32 + clz32(w);
+			map[i] &= ~BMAP_BIT(w);
+			bdirty(bp);
+			brelse(bp);
+			*pblockno = fs_hint = bm * BIT2BLK + w;
+			fs_hint++;
+			return 0;
+		}
+		brelse(bp);
+		bm = (bm + 1) % fs_nbitmap;
+		i = 0;
+	}
+	return -E_NO_DISK;
+}
+
+/* Overview:
+ *	Take block blockno if it is free.  Returns 0, or -E_NO_DISK.
+ */
+static int
+bitmap_take(u_int blockno)
+{
+	struct buf *bp;
+	u_int *w;
+	int r = -E_NO_DISK;
+
+	if (blockno >= fs_nblocks)
+		return r;
+	if ((bp = fs_bread(BMAP_BLOCK(blockno))) == NULL)
+		return -E_IO;
+	w = (u_int *)bp->b_data + (blockno % BIT2BLK) / 32;
+	if (*w & BMAP_BIT(blockno)) {
+		*w &= ~BMAP_BIT(blockno);
+		bdirty(bp);
+		fs_hint = blockno + 1;
+		r = 0;
+	}
+	brelse(bp);
+	return r;
+}
+
+/* Overview:
+ *	Free the n blocks from blockno on.
+ */
+static void
+bitmap_free(u_int blockno, u_int n)
+{
+	struct buf *bp = NULL;
+	u_int *map;
+
+	for (; n > 0; blockno++, n--) {
+		if (bp == NULL || bp->b_blockno != BMAP_BLOCK(blockno)) {
+			if (bp)
+				brelse(bp);
+			if ((bp = fs_bread(BMAP_BLOCK(blockno))) == NULL)
+				return;
+			bdirty(bp);
+		}
+		map = (u_int *)bp->b_data;
+		map[(blockno % BIT2BLK) / 32] |= BMAP_BIT(blockno);
+	}
+	if (bp)
+		brelse(bp);
+}
+
+static int
+block_zero(u_int blockno)
+{
+	struct buf *bp;
+
+	if ((bp = fs_bread(blockno)) == NULL)
+		return -E_IO;
+	bzero(bp->b_data, BY2BLK);
+	bdirty(bp);
+	brelse(bp);
+	return 0;
+}
+
+/* Overview:
+ *	Return extent i of f, reading its indirect block into *pbp if need
+ *	be (release it with brelse()).
+ */
+static struct Extent *
+file_extent(struct File *f, u_int i, struct buf **pbp)
+{
+	if (i < NEXTENT)
+		return &f->f_extent[i];
+	if (*pbp == NULL && (*pbp = fs_bread(f->f_indirect)) == NULL)
+		return NULL;
+	return (struct Extent *)(*pbp)->b_data + (i - NEXTENT);
+}
+
+/* Overview:
+ *	Find the disk block holding block fileblock of f.  Only a file of
+ *	more than NEXTENT extents costs a read, of its indirect block.
+ *	Returns 0 with it in *pblockno, or -E_NOT_FOUND past the end.
+ */
+static int
+file_map(struct File *f, u_int fileblock, u_int *pblockno)
+{
+	struct buf *bp = NULL;
+	struct Extent *e;
+	u_int i;
+	int r = -E_NOT_FOUND;
+
+	for (i = 0; i < f->f_nextent; i++) {
+		if ((e = file_extent(f, i, &bp)) == NULL) {
+			r = -E_IO;
+			break;
+		}
+		if (fileblock < e->e_len) {
+			*pblockno = e->e_start + fileblock;
+			r = 0;
+			break;
+		}
+		fileblock -= e->e_len;
+	}
+	if (bp)
+		brelse(bp);
+	return r;
+}
+
+/* Overview:
+ *	Add a zeroed block at the end of f: the one after its last extent
+ *	if that is free, else a new extent as close to it as possible.
+ */
+static int
+file_grow(struct File *f)
+{
+	struct buf *bp = NULL;
+	struct Extent *e = NULL;
+	u_int blockno, goal = fs_hint;
+	int r;
+
+	if (f->f_nextent > 0) {
+		if ((e = file_extent(f, f->f_nextent - 1, &bp)) == NULL)
+			return -E_IO;
+		goal = e->e_start + e->e_len;
+		if (bitmap_take(goal) == 0) {
+			e->e_len++;
+			if (bp) {
+				bdirty(bp);
+				brelse(bp);
+			}
+			return block_zero(goal);
+		}
+		if (bp)
+			brelse(bp);
+		bp = NULL;
+	}
+
+	if (f->f_nextent == NEXTENT + NINDEXTENT)
+		return -E_NO_DISK;
+	if ((r = bitmap_alloc(goal, &blockno)) < 0)
+		return r;
+	if (f->f_nextent == NEXTENT && f->f_indirect == 0) {
+		if ((r = bitmap_alloc(blockno, &f->f_indirect)) < 0 ||
+			(r = block_zero(f->f_indirect)) < 0) {
+			bitmap_free(blockno, 1);
+			return r;
+		}
+	}
+	if ((e = file_extent(f, f->f_nextent, &bp)) == NULL) {
+		bitmap_free(blockno, 1);
+		return -E_IO;
+	}
+	e->e_start = blockno;
+	e->e_len = 1;
+	f->f_nextent++;
+	if (bp) {
+		bdirty(bp);
+		brelse(bp);
+	}
+	return block_zero(blockno);
+}
+
+/* Overview:
+ *	Make f size bytes long, size >= f->f_size.  On failure f keeps the
+ *	blocks it did get.
+ */
+static int
+file_extend(struct File *f, u_int size)
+{
+	u_int have = ROUND(f->f_size, BY2BLK) / BY2BLK;
+	u_int want = ROUND(size, BY2BLK) / BY2BLK;
+	int r;
+
+	for (; have < want; have++) {
+		if ((r = file_grow(f)) < 0) {
+			if (have * BY2BLK > f->f_size)
+				f->f_size = have * BY2BLK;
+			return r;
+		}
+	}
+	f->f_size = size;
+	return 0;
+}
+
+/* Overview:
+ *	Give back every block of f, and its indirect block.
+ */
+static void
+file_free(struct File *f)
+{
+	struct buf *bp = NULL;
+	struct Extent *e;
+	u_int i;
+
+	for (i = 0; i < f->f_nextent; i++)
+		if ((e = file_extent(f, i, &bp)) != NULL)
+			bitmap_free(e->e_start, e->e_len);
+	if (bp)
+		brelse(bp);
+	if (f->f_indirect)
+		bitmap_free(f->f_indirect, 1);
+	f->f_nextent = 0;
+	f->f_indirect = 0;
+	f->f_size = 0;
+}
+
+/* Overview:
+ *	Write fn's File back to its place on disk.
+ */
+static int
+fnode_sync(struct Fnode *fn)
+{
+	struct buf *bp;
+
+	if ((bp = fs_bread(fn->fn_block)) == NULL)
+		return -E_IO;
+	bcopy(&fn->fn_file, bp->b_data + fn->fn_offset, sizeof(struct File));
+	bdirty(bp);
+	brelse(bp);
+	return 0;
+}
+
+static int
+fnode_root(struct Fnode *fn)
+{
+	struct buf *bp;
+
+	if ((bp = fs_bread(SUPERBLOCK)) == NULL)
+		return -E_IO;
+	fn->fn_block = SUPERBLOCK;
+	fn->fn_offset = offsetof(struct Super, s_root);
+	bcopy(bp->b_data + fn->fn_offset, &fn->fn_file, sizeof(struct File));
+	brelse(bp);
+	return 0;
+}
+
+/* FNV-1a */
+static u_int
+name_hash(const char *name)
+{
+	u_int h = 2166136261u;
+
+	while (*name)
+		h = (h ^ (u_char)*name++) * 16777619u;
+	return h;
+}
+
+static int
+name_eq(const char *a, const char *b)
+{
+	while (*a && *a == *b)
+		a++, b++;
+	return *a == *b;
+}
+
+/* Overview:
+ *	The number of hash tables in dir.  Its size is 2^n - 1 blocks.
+ */
+static int
+dir_ntables(struct File *dir)
+{
+	u_int nblk = dir->f_size / BY2BLK;
+	int n = 0;
+
+	while (nblk >> n)
+		n++;
+	return n;
+}
+
+/* Overview:
+ *	Look for name in table k of dir.  Returns 0 with its entry in *fn,
+ *	or -E_NOT_FOUND with *fn naming the first free or dead slot on the
+ *	probe path.
+ */
+static int
+dir_probe(struct File *dir, int k, const char *name, u_int h, struct Fnode *fn)
+{
+	struct buf *bp = NULL;
+	struct File *f;
+	u_int nslots = FILE2BLK << k, base = (1 << k) - 1;
+	u_int i, j, fileblock, blockno = 0, cur = ~0u;
+	int r = -E_NOT_FOUND, slot = 0;
+
+	for (j = 0, i = h & (nslots - 1); j < nslots; j++, i = (i + 1) & (nslots - 1)) {
+		fileblock = base + i / FILE2BLK;
+		if (fileblock != cur) {
+			if (bp)
+				brelse(bp);
+			bp = NULL;
+			cur = fileblock;
+			if ((r = file_map(dir, fileblock, &blockno)) < 0 ||
+				(bp = fs_bread(blockno)) == NULL) {
+				r = r < 0 ? r : -E_IO;
+				break;
+			}
+			r = -E_NOT_FOUND;
+		}
+		f = (struct File *)bp->b_data + i % FILE2BLK;
+
+		if (f->f_name[0] == 0 && !slot) {
+			slot = 1;
+			fn->fn_file = *f;
+			fn->fn_block = blockno;
+			fn->fn_offset = (i % FILE2BLK) * BY2FILE;
+		}
+		if (f->f_name[0] == 0 && f->f_type != FTYPE_DEAD)
+			break;
+		if (name_eq(f->f_name, name)) {
+			fn->fn_file = *f;
+			fn->fn_block = blockno;
+			fn->fn_offset = (i % FILE2BLK) * BY2FILE;
+			r = 0;
+			break;
+		}
+	}
+	if (bp)
+		brelse(bp);
+	return r;
+}
+
+/* Overview:
+ *	Look name up in dir, newest table first.
+ */
+static int
+dir_lookup(struct File *dir, const char *name, struct Fnode *fn)
+{
+	u_int h = name_hash(name);
+	int k, r;
+
+	for (k = dir_ntables(dir) - 1; k >= 0; k--)
+		if ((r = dir_probe(dir, k, name, h, fn)) != -E_NOT_FOUND)
+			return r;
+	return -E_NOT_FOUND;
+}
+
+/* Overview:
+ *	Enter a new, empty File called name into the directory dn, which
+ *	does not have it yet, and write dn back.
+ */
+static int
+dir_insert(struct Fnode *dn, const char *name, u_int type, struct Fnode *fn)
+{
+	struct File *dir = &dn->fn_file;
+	int k = dir_ntables(dir) - 1, r;
+
+	if (k < 0 || (dir->f_dirfill + 1) * 4 > (FILE2BLK << k) * 3) {
+		k++;
+		if ((r = file_extend(dir, dir->f_size + (BY2BLK << k))) < 0) {
+			fnode_sync(dn);
+			return r;
+		}
+		dir->f_dirfill = 0;
+	}
+	if ((r = dir_probe(dir, k, name, name_hash(name), fn)) != -E_NOT_FOUND)
+		return r < 0 ? r : -E_FILE_EXISTS;
+	if (fn->fn_file.f_type != FTYPE_DEAD)
+		dir->f_dirfill++;
+	dir->f_dirlive++;
+
+	bzero(&fn->fn_file, sizeof(struct File));
+	for (k = 0; name[k]; k++)
+		fn->fn_file.f_name[k] = name[k];
+	fn->fn_file.f_type = type;
+	if ((r = fnode_sync(fn)) < 0)
+		return r;
+	return fnode_sync(dn);
+}
+
+/* Overview:
+ *	Walk path from the root.  Returns 0 with the file in *fn, or an
+ *	error.  If only the last element is missing, returns -E_NOT_FOUND
+ *	with its directory in *dn and its name in last.
+ */
+static int
+walk_path(const char *path, struct Fnode *dn, struct Fnode *fn, char *last)
+{
+	char name[MAXNAMELEN];
+	int n, r;
+
+	if ((r = fnode_root(fn)) < 0)
+		return r;
+	for (;;) {
+		while (*path == '/')
+			path++;
+		if (*path == 0)
+			return 0;
+		for (n = 0; path[n] && path[n] != '/'; n++) {
+			if (n == MAXNAMELEN - 1)
+				return -E_BAD_PATH;
+			name[n] = path[n];
+		}
+		name[n] = 0;
+		path += n;
+
+		if (fn->fn_file.f_type != FTYPE_DIR)
+			return -E_NOT_FOUND;
+		*dn = *fn;
+		if ((r = dir_lookup(&dn->fn_file, name, fn)) < 0) {
+			while (*path == '/')
+				path++;
+			if (r == -E_NOT_FOUND && *path == 0 && last)
+				bcopy(name, last, n + 1);
+			return r;
+		}
+	}
+}
+
+/* Overview:
+ *	Make a file system of nblocks blocks on disk diskno, with an empty
+ *	root directory, and mount it.
+ */
+int
+fs_format(int diskno, u_int nblocks)
+{
+	struct buf *bp;
+	struct Super *s;
+	u_int nbitmap = ROUND(nblocks, BIT2BLK) / BIT2BLK;
+	u_int b, i, *map;
+	int r = -E_IO;
+
+	if (nblocks <= BITMAP + nbitmap)
+		return -E_INVAL;
+
+	spin_lock(&fs_lock);
+	fs_diskno = diskno;
+	fs_nblocks = nblocks;
+	fs_nbitmap = nbitmap;
+	fs_hint = BITMAP + nbitmap;
+
+	for (b = 0; b < nbitmap; b++) {
+		if ((bp = fs_bread(BITMAP + b)) == NULL)
+			goto out;
+		map = (u_int *)bp->b_data;
+		bzero(map, BY2BLK);
+		for (i = b * BIT2BLK; i < (b + 1) * BIT2BLK && i < nblocks; i++)
+			if (i >= BITMAP + nbitmap)
+				map[(i % BIT2BLK) / 32] |= BMAP_BIT(i);
+		bdirty(bp);
+		brelse(bp);
+	}
+
+	if ((bp = fs_bread(SUPERBLOCK)) == NULL)
+		goto out;
+	bzero(bp->b_data, BY2BLK);
+	s = (struct Super *)bp->b_data;
+	s->s_magic = FS_MAGIC;
+	s->s_nblocks = nblocks;
+	s->s_nbitmap = nbitmap;
+	s->s_root.f_name[0] = '/';
+	s->s_root.f_type = FTYPE_DIR;
+	bdirty(bp);
+	brelse(bp);
+	r = bcache_flush();
+out:
+	spin_unlock(&fs_lock);
+	return r;
+}
+
+/* Overview:
+ *	Mount the file system on disk diskno.  Returns 0, or -E_INVAL if
+ *	there is none.
+ */
+int
+fs_mount(int diskno)
+{
+	struct buf *bp;
+	struct Super *s;
+	int r = 0;
+
+	if ((bp = bread(diskno, SUPERBLOCK)) == NULL)
+		return -E_IO;
+	s = (struct Super *)bp->b_data;
+	spin_lock(&fs_lock);
+	if (s->s_magic != FS_MAGIC ||
+		s->s_nbitmap != ROUND(s->s_nblocks, BIT2BLK) / BIT2BLK) {
+		r = -E_INVAL;
+	} else {
+		fs_diskno = diskno;
+		fs_nblocks = s->s_nblocks;
+		fs_nbitmap = s->s_nbitmap;
+		fs_hint = BITMAP + fs_nbitmap;
+	}
+	spin_unlock(&fs_lock);
+	brelse(bp);
+	return r;
+}
+
+int
+fs_sync(void)
+{
+	return bcache_flush();
+}
+
+/* Overview:
+ *	Look path up.  Returns 0 with the file in *fn, or -E_NOT_FOUND.
+ */
+int
+file_open(const char *path, struct Fnode *fn)
+{
+	struct Fnode dn;
+	int r;
+
+	spin_lock(&fs_lock);
+	r = walk_path(path, &dn, fn, NULL);
+	spin_unlock(&fs_lock);
+	return r;
+}
+
+/* Overview:
+ *	Create an empty file or directory (type FTYPE_REG or FTYPE_DIR) at
+ *	path, whose directory must exist.  Returns 0 with it in *fn, or
+ *	-E_FILE_EXISTS, -E_NOT_FOUND, -E_NO_DISK.
+ */
+int
+file_create(const char *path, u_int type, struct Fnode *fn)
+{
+	char name[MAXNAMELEN];
+	struct Fnode dn;
+	int r;
+
+	if (type != FTYPE_REG && type != FTYPE_DIR)
+		return -E_INVAL;
+	name[0] = 0;
+	spin_lock(&fs_lock);
+	if ((r = walk_path(path, &dn, fn, name)) == 0)
+		r = -E_FILE_EXISTS;
+	else if (r == -E_NOT_FOUND && name[0])
+		r = dir_insert(&dn, name, type, fn);
+	spin_unlock(&fs_lock);
+	return r;
+}
+
+/* Overview:
+ *	Read up to n bytes at offset.  Returns the number read, 0 at the
+ *	end of the file, or -E_IO.
+ */
+int
+file_read(struct Fnode *fn, void *buf, u_int n, u_int offset)
+{
+	struct File *f = &fn->fn_file;
+	struct buf *bp;
+	u_int pos, end, blockno, m;
+	int r;
+
+	if (offset >= f->f_size)
+		return 0;
+	n = MIN(n, f->f_size - offset);
+
+	spin_lock(&fs_lock);
+	for (pos = offset, end = offset + n; pos < end; pos += m) {
+		if ((r = file_map(f, pos / BY2BLK, &blockno)) < 0 ||
+			(bp = fs_bread(blockno)) == NULL) {
+			spin_unlock(&fs_lock);
+			return r < 0 ? r : -E_IO;
+		}
+		m = MIN(BY2BLK - pos % BY2BLK, end - pos);
+		bcopy(bp->b_data + pos % BY2BLK, (u_char *)buf + (pos - offset), m);
+		brelse(bp);
+	}
+	spin_unlock(&fs_lock);
+	return n;
+}
+
+/* Overview:
+ *	Return a referenced buffer holding block fileblock of the file, which
+ *	is in the file; release it with brelse().  Returns 0, -E_INVAL past
+ *	the end of the file, or -E_IO.
+ */
+int
+file_getblock(struct Fnode *fn, u_int fileblock, struct buf **pbp)
+{
+	u_int blockno;
+	int r = 0;
+
+	if (fileblock >= ROUND(fn->fn_file.f_size, BY2BLK) / BY2BLK)
+		return -E_INVAL;
+	spin_lock(&fs_lock);
+	if ((r = file_map(&fn->fn_file, fileblock, &blockno)) == 0 &&
+		(*pbp = fs_bread(blockno)) == NULL)
+		r = -E_IO;
+	spin_unlock(&fs_lock);
+	return r;
+}
+
+/* Overview:
+ *	Write n bytes at offset, growing the file if need be.  Returns n,
+ *	or -E_NO_DISK, -E_IO.
+ */
+int
+file_write(struct Fnode *fn, const void *buf, u_int n, u_int offset)
+{
+	struct File *f = &fn->fn_file;
+	struct buf *bp;
+	u_int pos, end = offset + n, blockno, m;
+	int r = 0;
+
+	if (end < offset)
+		return -E_INVAL;
+
+	spin_lock(&fs_lock);
+	if (end > f->f_size) {
+		r = file_extend(f, end);
+		fnode_sync(fn);
+		if (r < 0)
+			goto out;
+	}
+	for (pos = offset; pos < end; pos += m) {
+		if ((r = file_map(f, pos / BY2BLK, &blockno)) < 0)
+			goto out;
+		if ((bp = fs_bread(blockno)) == NULL) {
+			r = -E_IO;
+			goto out;
+		}
+		m = MIN(BY2BLK - pos % BY2BLK, end - pos);
+		bcopy((const u_char *)buf + (pos - offset), bp->b_data + pos % BY2BLK, m);
+		bdirty(bp);
+		brelse(bp);
+	}
+	r = n;
+out:
+	spin_unlock(&fs_lock);
+	return r;
+}
+
+/* Overview:
+ *	Remove the file at path and free its blocks.  A directory must be
+ *	empty.
+ */
+int
+file_remove(const char *path)
+{
+	struct Fnode dn, fn;
+	int r;
+
+	spin_lock(&fs_lock);
+	if ((r = walk_path(path, &dn, &fn, NULL)) < 0)
+		goto out;
+	if (fn.fn_block == SUPERBLOCK ||
+		(fn.fn_file.f_type == FTYPE_DIR && fn.fn_file.f_dirlive > 0)) {
+		r = -E_INVAL;
+		goto out;
+	}
+	file_free(&fn.fn_file);
+	bzero(&fn.fn_file, sizeof(struct File));
+	fn.fn_file.f_type = FTYPE_DEAD;
+	if ((r = fnode_sync(&fn)) < 0)
+		goto out;
+	dn.fn_file.f_dirlive--;
+	r = fnode_sync(&dn);
+out:
+	spin_unlock(&fs_lock);
+	return r;
+}
@@ -0,0 +1,76 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <futex.h>
+#include <env.h>
+#include <pmap.h>
+#include <sched.h>
+#include <spinlock.h>
+#include <error.h>
+
+static struct spinlock futex_locks[NFUTEXQ] = {
+	[0 ... NFUTEXQ - 1] = SPINLOCK_INITIALIZER("futex"),
+};
+
+#define FUTEX_LOCK(pa)	(&futex_locks[((pa) >> 2) & (NFUTEXQ - 1)])
+
+/* Overview:
+ *	The physical address of the word at va in curenv, or ~0 if va is
+ *	not word aligned or not mapped.
+ */
+static u_long
+futex_key(u_long va)
+{
+	u_long pa;
+
+	if (va & 3 || va >= UTOP)
+		return ~0;
+	if ((pa = va2pa(curenv->env_pgdir, va)) == ~0)
+		return ~0;
+	return pa + (va & (BY2PG - 1));
+}
+
+/* Overview:
+ *	If the word at va is val, put curenv to sleep until futex_wake()
+ *	on it; the caller then gives up the cpu, as after sched_sleep().
+ *	Returns 0, -E_AGAIN if the word no longer held val, or -E_INVAL.
+ */
+int
+futex_wait(u_long va, u_int val)
+{
+	struct spinlock *lk;
+	u_long pa;
+	int r = 0;
+
+	if ((pa = futex_key(va)) == ~0)
+		return -E_INVAL;
+
+	lk = FUTEX_LOCK(pa);
+	spin_lock(lk);
+	if (*(volatile u_int *)KADDR(pa) != val)
+		r = -E_AGAIN;
+	else
+		sched_sleep((void *)pa);
+	spin_unlock(lk);
+	return r;
+}
+
+/* Overview:
+ *	Wake up to n of the envs waiting on the word at va, longest waiting
+ *	first.  Returns how many were woken, or -E_INVAL.
+ */
+int
+futex_wake(u_long va, u_int n)
+{
+	struct spinlock *lk;
+	u_long pa;
+	int r;
+
+	if ((pa = futex_key(va)) == ~0)
+		return -E_INVAL;
+
+	lk = FUTEX_LOCK(pa);
+	spin_lock(lk);
+	r = sched_wakeup_n((void *)pa, n);
+	spin_unlock(lk);
+	return r;
+}
@@ -0,0 +1,101 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <kstats.h>
+#include <pmap.h>
+#include <env.h>
+#include <printf.h>
+
+/* Page aligned so that mips_vm_init() can map it read-only at UKSTATS. */
+union kstats_page kstats_page __attribute__((aligned(BY2PG)));
+
+static const char *cause_name[KS_NCAUSE] = {
+	"Int", "Mod", "TLBL", "TLBS", "AdEL", "AdES", "IBE", "DBE",
+	"Sys", "Bp", "RI", "CpU", "Ov", "Tr",
+};
+
+static const char *ref_name[KS_NREF] = {
+	"0", "1", "2", "3", "4-7", "8-15", "16-31", "32+",
+};
+
+static const char *status_name[KS_NSTATUS] = {
+	"free", "runnable", "not runnable",
+};
+
+static int
+ref_bucket(u_int ref)
+{
+	int b;
+
+	if (ref < 4)
+		return ref;
+	for (b = 4, ref >>= 3; ref && b < KS_NREF - 1; ref >>= 1)
+		b++;
+	return b;
+}
+
+/* Overview:
+ *	Take a snapshot of the n pages starting at pp: how many are free
+ *	and how their pp_ref counts are distributed.
+ */
+void
+kstats_pages(struct Page *pp, u_long n)
+{
+	u_long i;
+
+	for (i = 0; i < KS_NREF; i++)
+		kstats.ks_ref[i] = 0;
+
+	for (i = 0; i < n; i++)
+		kstats.ks_ref[ref_bucket(pp[i].pp_ref)]++;
+
+	kstats.ks_npage = n;
+	kstats.ks_nfree = kstats.ks_ref[0];
+}
+
+/* Overview:
+ *	Take a snapshot of how many of the n envs starting at e sit in
+ *	each env_status.
+ */
+void
+kstats_envs(struct Env *e, int n)
+{
+	int i;
+
+	for (i = 0; i < KS_NSTATUS; i++)
+		kstats.ks_env[i] = 0;
+
+	for (i = 0; i < n; i++)
+		if (e[i].env_status < KS_NSTATUS)
+			kstats.ks_env[e[i].env_status]++;
+}
+
+void
+kstats_dump(void)
+{
+	int i;
+
+	printf("kstats:\n");
+	printf("  page alloc %d, free %d\n",
+		   kstats.ks_page_alloc, kstats.ks_page_free);
+	printf("  tlb refill %d\n", kstats.ks_tlb_refill);
+	printf("  ctx switch %d\n", kstats.ks_ctxsw);
+	printf("  ipc send   %d\n", kstats.ks_ipc_send);
+	printf("  swap out %d, in %d\n",
+		   kstats.ks_swap_out, kstats.ks_swap_in);
+
+	for (i = 0; i < KS_NCAUSE; i++) {
+		if (kstats.ks_trap[i] == 0)
+			continue;
+		if (cause_name[i])
+			printf("  trap %s\t%d\n", cause_name[i], kstats.ks_trap[i]);
+		else
+			printf("  trap #%d\t%d\n", i, kstats.ks_trap[i]);
+	}
+
+	printf("  pages %d, free %d\n", kstats.ks_npage, kstats.ks_nfree);
+	for (i = 0; i < KS_NREF; i++)
+		printf("    pp_ref %s\t%d\n", ref_name[i], kstats.ks_ref[i]);
+
+	for (i = 0; i < KS_NSTATUS; i++)
+		printf("  env %s\t%d\n", status_name[i], kstats.ks_env[i]);
+}
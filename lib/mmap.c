@@ -0,0 +1,238 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <mmap.h>
+#include <env.h>
+#include <pmap.h>
+#include <pgrange.h>
+#include <error.h>
+#include <spinlock.h>
+
+static struct Vmap vmaps[NVMAP];
+
+/* a page of a mapping that is mapped in */
+static struct Vpage {
+	struct Vmap *vp_map;		// NULL if free
+	u_int vp_index;			// page of the mapping
+	struct buf *vp_buf;		// referenced while mapped
+	int vp_dirty;			// mapped with PTE_R
+} vpages[NVPAGE];
+
+static u_int vp_hand;			// next to go when all are in use
+
+static struct spinlock mmap_lock = SPINLOCK_INITIALIZER("mmap");
+
+static struct Vmap *
+vmap_find(struct Env *e, u_long va)
+{
+	struct Vmap *v;
+
+	for (v = vmaps; v < vmaps + NVMAP; v++)
+		if (v->v_env == e && va >= v->v_va &&
+			va - v->v_va < v->v_npage * BY2PG)
+			return v;
+	return NULL;
+}
+
+/* Overview:
+ *	Unmap vp, start writing its buffer back if it was written to, and
+ *	let the buffer go.  page_remove() flushes the TLB entry.
+ */
+static void
+vpage_drop(struct Vpage *vp)
+{
+	struct Vmap *v = vp->vp_map;
+
+	page_remove(v->v_env->env_pgdir, v->v_va + vp->vp_index * BY2PG);
+	if (vp->vp_dirty) {
+		// a flush since the first write left the buffer clean, but
+		// the page stayed writable: later stores did not fault
+		bdirty(vp->vp_buf);
+		bawrite(vp->vp_buf);
+	}
+	brelse(vp->vp_buf);
+	vp->vp_map = NULL;
+}
+
+/* Overview:
+ *	Return a free Vpage for a fault of e, unmapping the oldest page that
+ *	can go to make one if need be.  page_remove() only reaches this
+ *	cpu's TLB, so that is a page of e, if no thread shares its space,
+ *	or of an env held off every cpu; the TLBs are shot down before the
+ *	env runs again.  Returns NULL if no page can go.
+ */
+static struct Vpage *
+vpage_get(struct Env *e)
+{
+	struct Vpage *vp;
+	struct Env *ve;
+	u_int n;
+
+	for (vp = vpages; vp < vpages + NVPAGE; vp++)
+		if (vp->vp_map == NULL)
+			return vp;
+
+	for (n = 0; n < NVPAGE; n++) {
+		vp = &vpages[vp_hand];
+		vp_hand = (vp_hand + 1) % NVPAGE;
+		ve = vp->vp_map->v_env;
+		if (ve == e && pa2page(e->env_cr3)->pp_ref == 1) {
+			vpage_drop(vp);
+			tlb_shootdown();
+			return vp;
+		}
+		if (ve != e && pmap_hold(ve)) {
+			vpage_drop(vp);
+			pmap_release(ve, 1);
+			return vp;
+		}
+	}
+	return NULL;
+}
+
+/* Overview:
+ *	Map len bytes of the file fn from offset on at va in env e, both
+ *	page aligned, writable if perm is PTE_R.  Pages come in on the
+ *	first touch.  Returns 0, -E_INVAL, or -E_NO_MEM if there are NVMAP
+ *	mappings already.
+ */
+int
+mmap_file(struct Env *e, u_long va, u_int len, struct Fnode *fn,
+	  u_int offset, u_int perm)
+{
+	struct Vmap *v, *free = NULL;
+	u_int npage = ROUND(len, BY2PG) / BY2PG;
+	int r = 0;
+
+	if (len == 0 || va % BY2PG || offset % BY2PG || (perm & ~PTE_R) ||
+		va >= UTOP || npage > (UTOP - va) / BY2PG)
+		return -E_INVAL;
+
+	spin_lock(&mmap_lock);
+	for (v = vmaps; v < vmaps + NVMAP; v++) {
+		if (v->v_env == NULL) {
+			if (free == NULL)
+				free = v;
+		} else if (v->v_env == e && va < v->v_va + v->v_npage * BY2PG &&
+			   v->v_va < va + npage * BY2PG) {
+			r = -E_INVAL;
+			goto out;
+		}
+	}
+	if ((v = free) == NULL) {
+		r = -E_NO_MEM;
+		goto out;
+	}
+	v->v_env = e;
+	v->v_va = va;
+	v->v_npage = npage;
+	v->v_perm = perm;
+	v->v_offset = offset;
+	v->v_fnode = *fn;
+out:
+	spin_unlock(&mmap_lock);
+	return r;
+}
+
+static void
+vmap_free(struct Vmap *v)
+{
+	struct Vpage *vp;
+
+	for (vp = vpages; vp < vpages + NVPAGE; vp++)
+		if (vp->vp_map == v)
+			vpage_drop(vp);
+	v->v_env = NULL;
+}
+
+/* Overview:
+ *	Undo the mmap_file() at va.
+ */
+int
+munmap_file(struct Env *e, u_long va)
+{
+	struct Vmap *v;
+	int r = 0;
+
+	spin_lock(&mmap_lock);
+	if ((v = vmap_find(e, va)) == NULL || v->v_va != va)
+		r = -E_INVAL;
+	else
+		vmap_free(v);
+	spin_unlock(&mmap_lock);
+	return r;
+}
+
+/* Overview:
+ *	Undo every mapping of e, before its page tables go away.
+ */
+void
+mmap_env_free(struct Env *e)
+{
+	struct Vmap *v;
+
+	spin_lock(&mmap_lock);
+	for (v = vmaps; v < vmaps + NVMAP; v++)
+		if (v->v_env == e)
+			vmap_free(v);
+	spin_unlock(&mmap_lock);
+}
+
+/* Overview:
+ *	Handle a fault of env e at va, a write if write is set.  Returns 0
+ *	if va is in a mapped file and the page is now mapped in, -E_INVAL
+ *	if the fault is not ours to handle (not mapped, a write to a
+ *	read-only mapping, past the end of the file), -E_NO_MEM if no
+ *	mapped page can make room, or -E_IO.
+ */
+int
+mmap_fault(struct Env *e, u_long va, int write)
+{
+	struct Vmap *v;
+	struct Vpage *vp;
+	struct buf *b;
+	Pte *pte;
+	u_int i, perm;
+	int r = -E_INVAL;
+
+	spin_lock(&mmap_lock);
+	if ((v = vmap_find(e, va)) == NULL || (write && !(v->v_perm & PTE_R)))
+		goto out;
+	va = ROUNDDOWN(va, BY2PG);
+	i = (va - v->v_va) / BY2PG;
+
+	// mapped in already: the first write to the page
+	for (vp = vpages; vp < vpages + NVPAGE; vp++)
+		if (vp->vp_map == v && vp->vp_index == i)
+			break;
+	if (vp < vpages + NVPAGE) {
+		if (write && !vp->vp_dirty && page_lookup(e->env_pgdir, va, &pte)) {
+			*pte |= PTE_R;
+			tlb_invalidate(e->env_pgdir, va);
+			vp->vp_dirty = 1;
+			bdirty(vp->vp_buf);
+		}
+		r = 0;
+		goto out;
+	}
+
+	if ((vp = vpage_get(e)) == NULL) {
+		r = -E_NO_MEM;
+		goto out;
+	}
+	if ((r = file_getblock(&v->v_fnode, v->v_offset / BY2BLK + i, &b)) < 0)
+		goto out;
+	perm = PTE_V | (write ? PTE_R : 0);
+	if ((r = page_insert(e->env_pgdir, pa2page(PADDR(b->b_data)), va, perm)) < 0) {
+		brelse(b);
+		goto out;
+	}
+	if (write)
+		bdirty(b);
+	vp->vp_map = v;
+	vp->vp_index = i;
+	vp->vp_buf = b;
+	vp->vp_dirty = write;
+out:
+	spin_unlock(&mmap_lock);
+	return r;
+}
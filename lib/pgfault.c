@@ -0,0 +1,60 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <pgfault.h>
+#include <env.h>
+#include <mmu.h>
+#include <error.h>
+
+/* Overview:
+ *	Send the fault described by tf to curenv e's handler.  Returns 0
+ *	with tf set to return into the handler, or -E_INVAL if e has no
+ *	handler or its exception stack overflowed; the caller destroys e.
+ *
+ *	The record is written through e's own mapping of its exception
+ *	stack, which e mapped before registering the handler.
+ */
+int
+pgfault_upcall(struct Env *e, struct Trapframe *tf)
+{
+	u_long sp = tf->regs[29];
+	u_long top = e->env_xstacktop;
+	struct UFault *uf;
+
+	if (e->env_pgfault_handler == 0)
+		return -E_INVAL;
+
+	if (sp - (top - BY2PG) < BY2PG)
+		sp = ROUNDDOWN(sp - UF_GAP - sizeof(struct UFault), 8);
+	else
+		sp = top - sizeof(struct UFault);
+	if (sp < top - BY2PG)
+		return -E_INVAL;
+
+	uf = (struct UFault *)sp;
+	uf->uf_va = tf->cp0_badvaddr;
+	uf->uf_cause = tf->cp0_cause;
+	uf->uf_epc = tf->cp0_epc;
+	uf->uf_sp = tf->regs[29];
+
+	tf->regs[29] = sp;
+	tf->cp0_epc = e->env_pgfault_handler;
+	return 0;
+}
+
+/* Overview:
+ *	If tf interrupted e in the resume sequence of its handler, move
+ *	EPC back to the restart point that reloads the k0 it lost.
+ */
+void
+pgfault_fixup(struct Env *e, struct Trapframe *tf)
+{
+	u_long off;
+
+	if (e->env_pgfault_handler == 0)
+		return;
+	off = tf->cp0_epc - (e->env_pgfault_handler - UF_RESUME_LEN);
+	if (off < UF_RESUME_RELOAD)
+		tf->cp0_epc -= off;
+	else if (off < UF_RESUME_LEN)
+		tf->cp0_epc -= off - UF_RESUME_RELOAD;
+}
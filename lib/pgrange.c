@@ -0,0 +1,295 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <pgrange.h>
+#include <cache.h>
+#include <pmap.h>
+#include <env.h>
+#include <sched.h>
+#include <spinlock.h>
+#include <error.h>
+
+#define KSEG0	0x80000000
+
+volatile u_int tlb_gen;
+static struct spinlock tlb_gen_lock = SPINLOCK_INITIALIZER("tlbgen");
+
+/* Overview:
+ *	Invalidate every TLB entry.  Each gets its own kseg0 VPN, which is
+ *	never looked up in the TLB, so no two entries ever match the same
+ *	address.  An R3000 has NTLB_R3000 entries, with the index in bits
+ *	13:8 of Index; a 4Kc says in Config1 how many pairs of pages it
+ *	has, takes the index in bits 5:0 and matches VPN2, two pages a
+ *	step.
+ */
+#ifdef __x86_64__
+
+void
+tlb_flush_all(void)
+{
+	// the host build has no TLB
+}
+
+#else
+
+void
+tlb_flush_all(void)
+{
+	u_long hi;
+	u_int config1;
+	int i, n;
+
+	asm volatile("mfc0 %0, $10" : "=r"(hi));
+	if (!cpu_is_4kc()) {
+		for (i = 0; i < NTLB_R3000; i++)
+			asm volatile(".set push\n\t.set noreorder\n\t"
+				     "mtc0 %0, $10\n\t"	// EntryHi
+				     "mtc0 $0, $2\n\t"	// EntryLo, not valid
+				     "mtc0 %1, $0\n\t"	// Index
+				     "nop\n\t"
+				     "tlbwi\n\t"
+				     ".set pop"
+				     : : "r"(KSEG0 + (i << PGSHIFT)), "r"(i << 8));
+	} else {
+		asm volatile(".set push\n\t.set mips32\n\t"
+			     "mfc0 %0, $16, 1\n\t.set pop" : "=r"(config1));
+		n = ((config1 >> 25) & 0x3f) + 1;	// MMU Size - 1
+		asm volatile("mtc0 $0, $5");		// PageMask, 4KB pages
+		for (i = 0; i < n; i++)
+			asm volatile(".set push\n\t.set noreorder\n\t"
+				     "mtc0 %0, $10\n\t"	// EntryHi, VPN2
+				     "mtc0 $0, $2\n\t"	// EntryLo0, not valid
+				     "mtc0 $0, $3\n\t"	// EntryLo1, not valid
+				     "mtc0 %1, $0\n\t"	// Index
+				     "nop\n\tnop\n\t"
+				     "tlbwi\n\t"
+				     ".set pop"
+				     : : "r"(KSEG0 + (i << (PGSHIFT + 1))), "r"(i));
+	}
+	asm volatile("mtc0 %0, $10" : : "r"(hi));
+}
+
+#endif /* __x86_64__ */
+
+/* Overview:
+ *	Make every cpu flush its TLB before it next runs an env.
+ */
+void
+tlb_shootdown(void)
+{
+	struct cpu *c = mycpu();
+
+	spin_lock(&tlb_gen_lock);
+	c->cpu_tlbgen = ++tlb_gen;
+	spin_unlock(&tlb_gen_lock);
+	tlb_flush_all();
+}
+
+/* Overview:
+ *	Hold e to change its page tables, if it is queued or asleep and
+ *	has its space to itself.  Returns 1 if it was.
+ */
+int
+pmap_hold(struct Env *e)
+{
+	// env_cr3 of a free env names no page; sched_hold() checks again
+	if (e->env_status == ENV_FREE ||
+	    pa2page(e->env_cr3)->pp_ref != 1)
+		return 0;
+	return sched_hold(e);
+}
+
+/* Let go of e; changed says whether any of its Ptes was. */
+void
+pmap_release(struct Env *e, int changed)
+{
+	if (changed)
+		tlb_shootdown();
+	sched_release(e);
+}
+
+void
+pgrange_init(struct pgrange *pr, Pde *pgdir, u_long va, u_long size,
+	     int create)
+{
+	pr->pr_pgdir = pgdir;
+	pr->pr_va = va;
+	pr->pr_next = va;
+	pr->pr_end = va + size < va ? ~0UL : va + size;
+	pr->pr_create = create;
+	pr->pr_error = 0;
+	pr->pr_pt = NULL;
+	pr->pr_ptva = 0;
+	pr->pr_ninval = 0;
+}
+
+/* Overview:
+ *	Make va, which is past the last page visited, the next one that
+ *	pgrange_next() visits.  Staying within the same PDMAP keeps the
+ *	page table.
+ */
+void
+pgrange_seek(struct pgrange *pr, u_long va)
+{
+	pr->pr_next = va;
+}
+
+/* Overview:
+ *	Return the Pte of the next page of the range and its va in pr_va,
+ *	or NULL at the end or when a page table could not be allocated
+ *	(pr_error).  Without create, pages with no page table are skipped.
+ */
+Pte *
+pgrange_next(struct pgrange *pr)
+{
+	u_long va;
+	Pde pde;
+	Pte *pte;
+
+	for (;;) {
+		va = pr->pr_next;
+		if (va >= pr->pr_end || va < pr->pr_va)
+			return NULL;
+
+		if (pr->pr_pt == NULL || ROUNDDOWN(va, PDMAP) != pr->pr_ptva) {
+			pr->pr_ptva = ROUNDDOWN(va, PDMAP);
+			pde = pr->pr_pgdir[PDX(va)];
+			if (pde & PTE_V) {
+				pr->pr_pt = (Pte *)KADDR(PTE_ADDR(pde));
+			} else if (pr->pr_create) {
+				if (pgdir_walk(pr->pr_pgdir, va, 1, &pte) < 0) {
+					pr->pr_pt = NULL;
+					pr->pr_error = -E_NO_MEM;
+					return NULL;
+				}
+				pr->pr_pt = pte - PTX(va);
+			} else {
+				pr->pr_pt = NULL;
+				pr->pr_va = va;
+				pr->pr_next = pr->pr_ptva + PDMAP;
+				continue;
+			}
+		}
+
+		pr->pr_va = va;
+		pr->pr_next = va + BY2PG;
+		return &pr->pr_pt[PTX(va)];
+	}
+}
+
+/* Overview:
+ *	Note that the TLB entry of the page last returned is stale.
+ */
+void
+pgrange_inval(struct pgrange *pr)
+{
+	if (pr->pr_ninval < PR_NINVAL)
+		pr->pr_inval[pr->pr_ninval] = pr->pr_va;
+	pr->pr_ninval++;
+}
+
+void
+pgrange_done(struct pgrange *pr)
+{
+	u_int i;
+
+	if (pr->pr_ninval > PR_NINVAL)
+		tlb_flush_all();
+	else
+		for (i = 0; i < pr->pr_ninval; i++)
+			tlb_invalidate(pr->pr_pgdir, pr->pr_inval[i]);
+	pr->pr_ninval = 0;
+}
+
+/* Overview:
+ *	Map the pages src has in [srcva, srcva + size) at the same offsets
+ *	from va in pgdir, keeping those of their permission bits that are
+ *	set in perm.  What pgdir had there goes; holes in src stay as they
+ *	were in pgdir.  Returns 0, or -E_NO_MEM with part of it mapped.
+ */
+int
+pmap_map_range(Pde *pgdir, u_long va, Pde *src, u_long srcva,
+	       u_long size, u_int perm)
+{
+	struct pgrange sr, dr;
+	Pte *spte, *dpte;
+
+	pgrange_init(&sr, src, srcva, size, 0);
+	pgrange_init(&dr, pgdir, va, size, 1);
+	while ((spte = pgrange_next(&sr)) != NULL) {
+		if (!(*spte & PTE_V))
+			continue;
+		pgrange_seek(&dr, va + (sr.pr_va - srcva));
+		if ((dpte = pgrange_next(&dr)) == NULL)
+			break;
+		pa2page(*spte)->pp_ref++;
+		if (*dpte & PTE_V) {
+			page_decref(pa2page(*dpte));
+			pgrange_inval(&dr);
+		}
+		*dpte = PTE_ADDR(*spte) | (*spte & perm & 0xfff) | PTE_V;
+	}
+	pgrange_done(&dr);
+	return dr.pr_error;
+}
+
+/* Overview:
+ *	Unmap every page in [va, va + size), freeing those nobody else
+ *	maps.  The page tables stay.
+ */
+void
+pmap_unmap_range(Pde *pgdir, u_long va, u_long size)
+{
+	struct pgrange pr;
+	Pte *pte;
+
+	pgrange_init(&pr, pgdir, va, size, 0);
+	while ((pte = pgrange_next(&pr)) != NULL) {
+		if (!(*pte & PTE_V))
+			continue;
+		page_decref(pa2page(*pte));
+		*pte = 0;
+		pgrange_inval(&pr);
+	}
+	pgrange_done(&pr);
+}
+
+/* Overview:
+ *	Give every page mapped in [va, va + size) the permissions perm.
+ */
+void
+pmap_protect_range(Pde *pgdir, u_long va, u_long size, u_int perm)
+{
+	struct pgrange pr;
+	Pte *pte, npte;
+
+	pgrange_init(&pr, pgdir, va, size, 0);
+	while ((pte = pgrange_next(&pr)) != NULL) {
+		if (!(*pte & PTE_V))
+			continue;
+		npte = PTE_ADDR(*pte) | (perm & 0xfff) | PTE_V;
+		if (npte != *pte) {
+			*pte = npte;
+			pgrange_inval(&pr);
+		}
+	}
+	pgrange_done(&pr);
+}
+
+/* Overview:
+ *	Set pa[i] to the physical address of page i from va, ~0 if it is
+ *	not mapped: va2pa() for npage pages at once.
+ */
+void
+pmap_translate_range(Pde *pgdir, u_long va, u_long npage, u_long *pa)
+{
+	struct pgrange pr;
+	Pte *pte;
+	u_long i;
+
+	for (i = 0; i < npage; i++)
+		pa[i] = ~0UL;
+	pgrange_init(&pr, pgdir, va, npage * BY2PG, 0);
+	while ((pte = pgrange_next(&pr)) != NULL)
+		if (*pte & PTE_V)
+			pa[(pr.pr_va - va) / BY2PG] = PTE_ADDR(*pte);
+}
@@ -0,0 +1,204 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <pmerge.h>
+#include <pmap.h>
+#include <env.h>
+#include <pgrange.h>
+#include <spinlock.h>
+#include <error.h>
+
+struct pm_stable {
+	u_int s_hash;
+	struct Page *s_page;		// may have been split or freed since
+};
+
+struct pm_cand {
+	u_int c_hash;
+	u_int c_envid;			// 0 if the slot is empty
+	u_long c_va;
+};
+
+static struct pm_stable pm_stable[PM_NSTABLE];
+static struct pm_cand pm_cand[PM_NCAND];
+
+static u_int pm_env;			// ENVX() of the env being scanned
+static u_long pm_va;			// where to go on in it
+
+u_int pmerge_nfreed;			// pages freed by merging
+
+// guards PP_MERGED and pp_ref of merged pages
+static struct spinlock pmerge_lock = SPINLOCK_INITIALIZER("pmerge");
+
+static u_int
+pm_hash(const u_int *p)
+{
+	u_int h = 2166136261u;		// FNV-1a, a word at a time
+	int i;
+
+	for (i = 0; i < BY2PG / 4; i++)
+		h = (h ^ p[i]) * 16777619u;
+	return h;
+}
+
+static int
+pm_same(const u_int *a, const u_int *b)
+{
+	int i;
+
+	for (i = 0; i < BY2PG / 4; i++)
+		if (a[i] != b[i])
+			return 0;
+	return 1;
+}
+
+/* A page only this mapping has, and writable: worth merging. */
+static int
+pm_private(Pte pte)
+{
+	return (pte & (PTE_V | PTE_R | PTE_UC | PTE_MERGED)) ==
+	       (PTE_V | PTE_R) && pa2page(pte)->pp_ref == 1;
+}
+
+/* Map merged page pp instead of the equal private page pte maps. */
+static void
+pm_share(Pte *pte, struct Page *pp)
+{
+	pp->pp_ref++;
+	page_decref(pa2page(*pte));
+	*pte = page2pa(pp) | (*pte & 0xfff & ~PTE_R) | PTE_MERGED;
+	pmerge_nfreed++;
+}
+
+/* Overview:
+ *	Merge the private page pte maps at va in held env e with an equal
+ *	merged page or candidate, or make it a candidate.  Returns 1 if it
+ *	was merged, which changed *pte.
+ */
+static int
+pm_merge(struct Env *e, u_long va, Pte *pte)
+{
+	const u_int *data = (const u_int *)page2kva(pa2page(*pte));
+	u_int h = pm_hash(data);
+	struct pm_stable *s = &pm_stable[h & (PM_NSTABLE - 1)];
+	struct pm_cand *c = &pm_cand[h & (PM_NCAND - 1)];
+	struct Page *cp;
+	struct Env *ce;
+	Pte *cpte;
+	int merged = 0;
+
+	spin_lock(&pmerge_lock);
+	if (s->s_page != NULL && s->s_hash == h &&
+	    (s->s_page->pp_flags & PP_MERGED) &&
+	    s->s_page->pp_ref < PM_MAXREF &&
+	    pm_same(data, (const u_int *)page2kva(s->s_page))) {
+		pm_share(pte, s->s_page);
+		merged = 1;
+	}
+	spin_unlock(&pmerge_lock);
+	if (merged)
+		return 1;
+
+	if (c->c_envid == 0 || c->c_hash != h ||
+	    (c->c_envid == e->env_id && c->c_va == va))
+		goto candidate;
+
+	ce = &envs[ENVX(c->c_envid)];
+	if (ce->env_id != c->c_envid || (ce != e && !pmap_hold(ce)))
+		goto candidate;
+	if (ce->env_id != c->c_envid) {
+		// freed and taken again before we held it
+		pmap_release(ce, 0);
+		goto candidate;
+	}
+
+	if (pgdir_walk(ce->env_pgdir, c->c_va, 0, &cpte) == 0 &&
+	    cpte != NULL && pm_private(*cpte) && cpte != pte &&
+	    pm_same(data, (const u_int *)page2kva(cp = pa2page(*cpte)))) {
+		spin_lock(&pmerge_lock);
+		cp->pp_flags |= PP_MERGED;
+		*cpte = (*cpte & ~PTE_R) | PTE_MERGED;
+		pm_share(pte, cp);
+		spin_unlock(&pmerge_lock);
+		s->s_hash = h;
+		s->s_page = cp;
+		c->c_envid = 0;
+		merged = 1;
+	}
+	if (ce != e)
+		pmap_release(ce, merged);
+	if (merged)
+		return 1;
+
+candidate:
+	c->c_hash = h;
+	c->c_envid = e->env_id;
+	c->c_va = va;
+	return 0;
+}
+
+/* Overview:
+ *	Look at up to budget more user pages for ones to merge, going on
+ *	from where the last call stopped.
+ */
+void
+pmerge_scan(u_int budget)
+{
+	struct pgrange pr;
+	struct Env *e;
+	Pte *pte;
+	u_int n;
+	int changed;
+
+	for (n = 0; budget > 0 && n < NENV; n++) {
+		e = &envs[pm_env];
+		if (pmap_hold(e)) {
+			changed = 0;
+			pgrange_init(&pr, e->env_pgdir, pm_va, UTOP - pm_va, 0);
+			while (budget > 0 && (pte = pgrange_next(&pr)) != NULL) {
+				budget--;
+				if (pm_private(*pte))
+					changed |= pm_merge(e, pr.pr_va, pte);
+			}
+			pmap_release(e, changed);
+			if (budget == 0 && pr.pr_next < UTOP) {
+				pm_va = pr.pr_next;
+				return;
+			}
+		}
+		pm_env = (pm_env + 1) & (NENV - 1);
+		pm_va = 0;
+	}
+}
+
+/* Overview:
+ *	Give the env whose page directory is pgdir a page of its own where
+ *	it wrote to a merged page at va, for the TLB Mod handler.  Returns
+ *	0, -E_INVAL if the page at va is not merged, or -E_NO_MEM.
+ */
+int
+pmerge_fault(Pde *pgdir, u_long va)
+{
+	struct Page *pp, *np;
+	Pte *pte;
+	u_int perm;
+	int r = 0;
+
+	if (pgdir_walk(pgdir, va, 0, &pte) < 0 || pte == NULL ||
+	    (*pte & (PTE_V | PTE_MERGED)) != (PTE_V | PTE_MERGED))
+		return -E_INVAL;
+	pp = pa2page(*pte);
+	perm = (*pte & 0xfff & ~PTE_MERGED) | PTE_R;
+
+	spin_lock(&pmerge_lock);
+	if (pp->pp_ref == 1) {
+		// the last one: the page is private again
+		pp->pp_flags &= ~PP_MERGED;
+		*pte = page2pa(pp) | perm;
+		tlb_invalidate(pgdir, va);
+	} else if ((r = page_alloc(&np)) == 0) {
+		bcopy((void *)page2kva(pp), (void *)page2kva(np), BY2PG);
+		r = page_insert(pgdir, np, va, perm);
+	}
+	spin_unlock(&pmerge_lock);
+	return r;
+}
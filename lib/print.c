@@ -10,20 +10,87 @@
  */
 
 #include	<print.h>
+#include	<types.h>
 
 /* macros */
 #define        IsDigit(x)    ( ((x) >= '0') && ((x) <= '9') )
 #define        Ctod(x)        ( (x) - '0')
 
 /* forward declaration */
-extern int PrintChar(char *, char, int, int);
+typedef void (*lp_Output)(void *, char *, int);
 
-extern int PrintString(char *, char *, int, int);
+struct lp_Spec;
 
-extern int PrintNum(char *, unsigned long, int, int, int, int, char, int);
+static void PrintChar(lp_Output, void *, char, struct lp_Spec *);
 
-/* private variable */
-static const char theFatalMsg[] = "fatal error in lp_Print!";
+static void PrintString(lp_Output, void *, char *, struct lp_Spec *);
+
+static void PrintNum(lp_Output, void *, u_quad_t, int, const char *, char,
+                     struct lp_Spec *);
+
+/* padding is emitted from these in chunks of up to LP_PAD_CHUNK chars */
+#define LP_PAD_CHUNK	32
+static char theSpaces[LP_PAD_CHUNK + 1] = "                                ";
+static char theZeros[LP_PAD_CHUNK + 1] = "00000000000000000000000000000000";
+
+/* one conversion specification: %[flags][width][.prec][length]conv */
+struct lp_Spec {
+    int flags;
+    int width;
+    int prec;       // precision, -1 if none was given
+};
+
+#define LP_LADJUST	0x01	// '-'
+#define LP_ZEROPAD	0x02	// '0'
+#define LP_PLUS		0x04	// '+'
+#define LP_SPACE	0x08	// ' '
+#define LP_ALT		0x10	// '#'
+#define LP_PREFIX	0x20	// 0x even in front of a zero, for %p
+
+/* length modifiers */
+#define LP_CHAR		1	// hh
+#define LP_SHORT	2	// h
+#define LP_LONG		3	// l, L
+#define LP_QUAD		4	// ll, q
+
+/*
+ * The conversion character indexes this table; the switch in lp_Print()
+ * on lc_kind is dense, so it compiles to a single jump.  Anything not
+ * listed is LP_OTHER and printed as it is.
+ */
+enum { LP_OTHER, LP_END, LP_SIGNED, LP_UNSIGNED, LP_POINTER, LP_CHR,
+       LP_STRING, LP_PERCENT };
+
+static const char theLower[] = "0123456789abcdef";
+static const char theUpper[] = "0123456789ABCDEF";
+// lab1-exam: %t and %T print base 11, with 'x' for ten
+static const char theElevenLower[] = "0123456789x";
+static const char theElevenUpper[] = "0123456789X";
+
+static const struct lp_Conv {
+    unsigned char lc_kind;
+    unsigned char lc_base;
+    const char *lc_digits;
+} theConvs[128] = {
+    ['\0'] = { LP_END },
+    ['d'] = { LP_SIGNED, 10, theLower },
+    ['D'] = { LP_SIGNED, 10, theLower },
+    ['i'] = { LP_SIGNED, 10, theLower },
+    ['u'] = { LP_UNSIGNED, 10, theLower },
+    ['U'] = { LP_UNSIGNED, 10, theLower },
+    ['o'] = { LP_UNSIGNED, 8, theLower },
+    ['O'] = { LP_UNSIGNED, 8, theLower },
+    ['x'] = { LP_UNSIGNED, 16, theLower },
+    ['X'] = { LP_UNSIGNED, 16, theUpper },
+    ['b'] = { LP_UNSIGNED, 2, theLower },
+    ['t'] = { LP_UNSIGNED, 11, theElevenLower },
+    ['T'] = { LP_UNSIGNED, 11, theElevenUpper },
+    ['p'] = { LP_POINTER, 16, theLower },
+    ['c'] = { LP_CHR },
+    ['s'] = { LP_STRING },
+    ['%'] = { LP_PERCENT },
+};
+static const struct lp_Conv theOther = { LP_OTHER };
 
 /* -*-
  * A low level printf() function.
@@ -35,28 +102,15 @@ lp_Print(void (*output)(void *, char *, int),
          va_list ap) {
 
 #define    OUTPUT(arg, s, l)  \
-  { if (((l) < 0) || ((l) > LP_MAX_BUF)) { \
-       (*output)(arg, (char*)theFatalMsg, sizeof(theFatalMsg)-1); for(;;); \
-    } else { \
-      (*output)(arg, s, l); \
-    } \
-  }
-
-    char buf[LP_MAX_BUF];
-
-    char c;
-    char *s;
-    long int num;
-
-    int longFlag;
-    int negFlag;
-    int width;
-    int prec;       // precision
-    int ladjust;    // padding align
-    char padc;      // padding character
-
-    int length;
+  { if ((l) > 0) (*output)(arg, s, l); }
 
+    const struct lp_Conv *cv;
+    struct lp_Spec spec;
+    u_quad_t num;
+    quad_t snum;
+    char sign;
+    int lenmod;
+    unsigned char c;
 
     for (;;) {
         /* scan for the next '%' */
@@ -77,281 +131,290 @@ lp_Print(void (*output)(void *, char *, int),
         /* we found a '%' */
         fmt++;
 
-        ladjust = 0;
-        padc = ' ';
-
-        if (*fmt == '-') {
-            ladjust = 1;
-            fmt++;
+        /* flags, in any order */
+        spec.flags = 0;
+        for (;; fmt++) {
+            if (*fmt == '-') spec.flags |= LP_LADJUST;
+            else if (*fmt == '0') spec.flags |= LP_ZEROPAD;
+            else if (*fmt == '+') spec.flags |= LP_PLUS;
+            else if (*fmt == ' ') spec.flags |= LP_SPACE;
+            else if (*fmt == '#') spec.flags |= LP_ALT;
+            else break;
         }
 
-        if (*fmt == '0') {
-            padc = '0';
+        /* width; a negative '*' argument means left adjusted */
+        spec.width = 0;
+        if (*fmt == '*') {
+            spec.width = va_arg(ap, int);
+            if (spec.width < 0) {
+                spec.flags |= LP_LADJUST;
+                spec.width = -spec.width;
+            }
             fmt++;
+        } else {
+            while (IsDigit(*fmt)) {
+                spec.width = 10 * spec.width + Ctod(*fmt++);
+            }
         }
 
-        width = 0;
-        while (IsDigit(*fmt)) {
-            width = 10 * width + Ctod(*fmt++);
+        /* precision; a negative '*' argument means none */
+        spec.prec = -1;
+        if (*fmt == '.') {
+            fmt++;
+            spec.prec = 0;
+            if (*fmt == '*') {
+                spec.prec = va_arg(ap, int);
+                if (spec.prec < 0) spec.prec = -1;
+                fmt++;
+            } else {
+                while (IsDigit(*fmt)) {
+                    spec.prec = 10 * spec.prec + Ctod(*fmt++);
+                }
+            }
         }
 
-        /* check for long */
-        longFlag = 0;
-        if (*fmt == 'l' || *fmt == 'L') {
-            longFlag = 1;
+        /* length modifier */
+        lenmod = 0;
+        if (*fmt == 'h') {
+            lenmod = LP_SHORT;
+            if (*++fmt == 'h') {
+                lenmod = LP_CHAR;
+                fmt++;
+            }
+        } else if (*fmt == 'l') {
+            lenmod = LP_LONG;
+            if (*++fmt == 'l') {
+                lenmod = LP_QUAD;
+                fmt++;
+            }
+        } else if (*fmt == 'L') {
+            lenmod = LP_LONG;
+            fmt++;
+        } else if (*fmt == 'q') {
+            lenmod = LP_QUAD;
             fmt++;
         }
 
-        /* check format flag */
-        negFlag = 0;
-
-        switch (*fmt) {
-            case 'b':
-                if (longFlag) {
-                    num = va_arg(ap, long
-                            int);
+        c = *fmt;
+        cv = c < 128 ? &theConvs[c] : &theOther;
+
+        switch (cv->lc_kind) {
+            case LP_SIGNED:
+                if (lenmod == LP_QUAD) snum = va_arg(ap, quad_t);
+                else if (lenmod == LP_LONG) snum = va_arg(ap, long);
+                else if (lenmod == LP_SHORT) snum = (short) va_arg(ap, int);
+                else if (lenmod == LP_CHAR) snum = (signed char) va_arg(ap, int);
+                else snum = va_arg(ap, int);
+
+                sign = 0;
+                if (snum < 0) {
+                    sign = '-';
+                    num = -(u_quad_t) snum;
                 } else {
-                    num = va_arg(ap, int);
+                    num = snum;
+                    if (spec.flags & LP_PLUS) sign = '+';
+                    else if (spec.flags & LP_SPACE) sign = ' ';
                 }
-
-                length = PrintNum(buf, num, 2, 0, width, ladjust, padc, 0);
-                OUTPUT(arg, buf, length);
+                PrintNum(output, arg, num, cv->lc_base, cv->lc_digits, sign,
+                         &spec);
                 break;
 
-            case 'd':
-            case 'D':
-                if (longFlag) {
-                    num = va_arg(ap, long
-                            int);
-                } else {
-                    num = va_arg(ap, int);
-                }
-
-                if (num < 0) {
-                    num = -num;
-                    negFlag = 1;
-                }
+            case LP_UNSIGNED:
+                if (lenmod == LP_QUAD) num = va_arg(ap, u_quad_t);
+                else if (lenmod == LP_LONG) num = va_arg(ap, unsigned long);
+                else if (lenmod == LP_SHORT) num = (u_short) va_arg(ap, int);
+                else if (lenmod == LP_CHAR) num = (u_char) va_arg(ap, int);
+                else num = va_arg(ap, unsigned int);
 
-                length = PrintNum(buf, num, 10, negFlag, width, ladjust, padc, 0);
-                OUTPUT(arg, buf, length);
+                PrintNum(output, arg, num, cv->lc_base, cv->lc_digits, 0,
+                         &spec);
                 break;
 
-            case 'o':
-            case 'O':
-                if (longFlag) {
-                    num = va_arg(ap, long
-                            int);
-                } else {
-                    num = va_arg(ap, int);
-                }
-
-                length = PrintNum(buf, num, 8, 0, width, ladjust, padc, 0);
-                OUTPUT(arg, buf, length);
+            case LP_POINTER:
+                /* like %#lx, but 0x0 for NULL */
+                num = (u_long) va_arg(ap, void *);
+                spec.flags |= LP_ALT | LP_PREFIX;
+                PrintNum(output, arg, num, 16, cv->lc_digits, 0, &spec);
                 break;
 
-            case 'u':
-            case 'U':
-                if (longFlag) {
-                    num = va_arg(ap, long
-                            int);
-                } else {
-                    num = va_arg(ap, int);
-                }
-
-                length = PrintNum(buf, num, 10, 0, width, ladjust, padc, 0);
-                OUTPUT(arg, buf, length);
+            case LP_CHR:
+                PrintChar(output, arg, (char) va_arg(ap, int), &spec);
                 break;
 
-            case 'x':
-                if (longFlag) {
-                    num = va_arg(ap, long
-                            int);
-                } else {
-                    num = va_arg(ap, int);
-                }
-
-                length = PrintNum(buf, num, 16, 0, width, ladjust, padc, 0);
-                OUTPUT(arg, buf, length);
+            case LP_STRING:
+                PrintString(output, arg, va_arg(ap, char *), &spec);
                 break;
 
-            case 'X':
-                if (longFlag) {
-                    num = va_arg(ap, long
-                            int);
-                } else {
-                    num = va_arg(ap, int);
-                }
-
-                length = PrintNum(buf, num, 16, 0, width, ladjust, padc, 1);
-                OUTPUT(arg, buf, length);
+            case LP_PERCENT:
+                OUTPUT(arg, fmt, 1);
                 break;
-                // *********************************************************
-                // lab1-exam
 
-            case 't':
-                if (longFlag) {
-                    num = va_arg(ap, long
-                            int);
-                } else {
-                    num = va_arg(ap, int);
-                }
-
-                length = PrintNum(buf, num, 11, 0, width, ladjust, padc, 0);
-                OUTPUT(arg, buf, length);
-                break;
-
-            case 'T':
-                if (longFlag) {
-                    num = va_arg(ap, long
-                            int);
-                } else {
-                    num = va_arg(ap, int);
-                }
-
-                length = PrintNum(buf, num, 11, 0, width, ladjust, padc, 1);
-                OUTPUT(arg, buf, length);
-                break;
-
-                // *********************************************************
-                // lab1-exam end
-            case 'c':
-                c = (char) va_arg(ap, int);
-                length = PrintChar(buf, c, width, ladjust);
-                OUTPUT(arg, buf, length);
-                break;
-
-            case 's':
-                s = (char *) va_arg(ap, char *);
-                length = PrintString(buf, s, width, ladjust);
-                OUTPUT(arg, buf, length);
-                break;
-
-            case '\0':
+            case LP_END:
                 fmt--;
                 break;
 
             default:
                 /* output this char as it is */
             OUTPUT(arg, fmt, 1);
-        }    /* switch (*fmt) */
+        }    /* switch (cv->lc_kind) */
 
         fmt++;
     }        /* for(;;) */
 
 
-    /* special termination call */
-    OUTPUT(arg, "\0", 1);
+    /* special termination call: no conversion outputs 0 chars */
+    (*output)(arg, "", 0);
 }
 
 
 /* --------------- local help functions --------------------- */
-int
-PrintChar(char *buf, char c, int length, int ladjust) {
-    int i;
-
-    if (length < 1) length = 1;
-    if (ladjust) {
-        *buf = c;
-        for (i = 1; i < length; i++) buf[i] = ' ';
-    } else {
-        for (i = 0; i < length - 1; i++) buf[i] = ' ';
-        buf[length - 1] = c;
+static void
+PrintPad(lp_Output output, void *arg, char padc, int n) {
+    char *pad = padc == '0' ? theZeros : theSpaces;
+
+    while (n > LP_PAD_CHUNK) {
+        (*output)(arg, pad, LP_PAD_CHUNK);
+        n -= LP_PAD_CHUNK;
+    }
+    if (n > 0) {
+        (*output)(arg, pad, n);
     }
-    return length;
 }
 
-int
-PrintString(char *buf, char *s, int length, int ladjust) {
-    int i;
-    int len = 0;
-    char *s1 = s;
-    while (*s1++) len++;
-    if (length < len) length = len;
+static void
+PrintChar(lp_Output output, void *arg, char c, struct lp_Spec *spec) {
+    int ladjust = spec->flags & LP_LADJUST;
 
-    if (ladjust) {
-        for (i = 0; i < len; i++) buf[i] = s[i];
-        for (i = len; i < length; i++) buf[i] = ' ';
-    } else {
-        for (i = 0; i < length - len; i++) buf[i] = ' ';
-        for (i = length - len; i < length; i++) buf[i] = s[i - length + len];
-    }
-    return length;
+    if (!ladjust) PrintPad(output, arg, ' ', spec->width - 1);
+    (*output)(arg, &c, 1);
+    if (ladjust) PrintPad(output, arg, ' ', spec->width - 1);
 }
 
-int
-PrintNum(char *buf, unsigned long u, int base, int negFlag,
-         int length, int ladjust, char padc, int upcase) {
-    /* algorithm :
-     *  1. prints the number from left to right in reverse form.
-     *  2. fill the remaining spaces with padc if length is longer than
-     *     the actual length
-     *     TRICKY : if left adjusted, no "0" padding.
-     *		    if negtive, insert  "0" padding between "0" and number.
-     *  3. if (!ladjust) we reverse the whole string including paddings
-     *  4. otherwise we only reverse the actual string representing the num.
-     */
+static void
+PrintString(lp_Output output, void *arg, char *s, struct lp_Spec *spec) {
+    int ladjust = spec->flags & LP_LADJUST;
+    int len = 0;
 
-    int actualLength = 0;
-    char *p = buf;
-    int i;
-
-    do {
-        int tmp = u % base;
-        if (tmp <= 9) {
-            *p++ = '0' + tmp;
-        } else if (upcase) {
-            if (base == 11)
-                *p++ = 'X';
-            else
-                *p++ = 'A' + tmp - 10;
-        } else {
-            if (base == 11)
-                *p++ = 'x';
-            else
-                *p++ = 'a' + tmp - 10;
-        }
-        u /= base;
-    } while (u != 0);
+    if (s == NULL) s = "(null)";
 
-    if (negFlag) {
-        *p++ = '-';
+    /* with a precision, s need not be terminated within prec chars */
+    if (spec->prec >= 0) {
+        while (len < spec->prec && s[len]) len++;
+    } else {
+        while (s[len]) len++;
     }
 
-    /* figure out actual length and adjust the maximum length */
-    actualLength = p - buf;
-    if (length < actualLength) length = actualLength;
+    /* the string goes out as it is, however long, without a copy */
+    if (!ladjust) PrintPad(output, arg, ' ', spec->width - len);
+    if (len > 0) (*output)(arg, s, len);
+    if (ladjust) PrintPad(output, arg, ' ', spec->width - len);
+}
 
-    /* add padding */
-    if (ladjust) {
-        padc = ' ';
-    }
-    if (negFlag && !ladjust && (padc == '0')) {
-        for (i = actualLength - 1; i < length - 1; i++) buf[i] = padc;
-        buf[length - 1] = '-';
-    } else {
-        for (i = actualLength; i < length; i++) buf[i] = padc;
-    }
+/* Overview:
+ *	Divide u by a base of at most 16 using only 32-bit divisions, one
+ *	16-bit piece of the low word at a time: the kernel is not linked
+ *	against libgcc, so a plain u_quad_t '/' would not link on MIPS.
+ */
+static u_quad_t
+DivQuad(u_quad_t u, u_int base, u_int *rem) {
+    u_int hi = u >> 32;
+    u_int lo = u;
+    u_int qhi, q1, q0, t;
+
+    qhi = hi / base;
+    t = ((hi % base) << 16) | (lo >> 16);
+    q1 = t / base;
+    t = ((t % base) << 16) | (lo & 0xffff);
+    q0 = t / base;
+    *rem = t % base;
+
+    return ((u_quad_t) qhi << 32) | (q1 << 16) | q0;
+}
 
+static void
+PrintNum(lp_Output output, void *arg, u_quad_t u, int base,
+         const char *digits, char sign, struct lp_Spec *spec) {
+    /* algorithm :
+     *  1. render the digits from right to left into the end of buf.
+     *  2. work out the prefix (sign or 0x) and the zeros the precision
+     *     asks for, then stream padding, prefix, zeros and digits.
+     *     TRICKY : "0" padding goes between the prefix and the number,
+     *		    and is ignored if left adjusted or given a precision.
+     */
 
-    /* prepare to reverse the string */
-    {
-        int begin = 0;
-        int end;
-        if (ladjust) {
-            end = actualLength - 1;
+    char buf[LP_NUM_BUF];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    char prefix[2];
+    int nprefix = 0;
+    int ndigit, nzero, npad;
+    int nonzero = u != 0;
+    u_long v;
+    u_int r;
+
+    /* 64-bit values lose their high word the slow way first */
+    while (u != (u_long) u) {
+        u = DivQuad(u, base, &r);
+        *--p = digits[r];
+    }
+    v = u;
+
+    /* %.0d of zero prints no digits at all; the common bases get a
+     * constant divisor or a shift instead of a real division */
+    if (v != 0 || p != end || spec->prec != 0) {
+        if (base == 10) {
+            do {
+                *--p = '0' + v % 10;
+                v /= 10;
+            } while (v != 0);
+        } else if (base == 16) {
+            do {
+                *--p = digits[v & 15];
+                v >>= 4;
+            } while (v != 0);
+        } else if (base == 8) {
+            do {
+                *--p = '0' + (v & 7);
+                v >>= 3;
+            } while (v != 0);
         } else {
-            end = length - 1;
+            do {
+                *--p = digits[v % base];
+                v /= base;
+            } while (v != 0);
         }
-
-        while (end > begin) {
-            char tmp = buf[begin];
-            buf[begin] = buf[end];
-            buf[end] = tmp;
-            begin++;
-            end--;
+    }
+    ndigit = end - p;
+
+    nzero = spec->prec > ndigit ? spec->prec - ndigit : 0;
+
+    if (sign) {
+        prefix[nprefix++] = sign;
+    } else if (spec->flags & LP_ALT) {
+        if (base == 8) {
+            // the alternate form of octal always starts with a zero
+            if (nzero == 0 && (ndigit == 0 || *p != '0')) nzero = 1;
+        } else if (base == 16 && (nonzero || (spec->flags & LP_PREFIX))) {
+            prefix[nprefix++] = '0';
+            prefix[nprefix++] = digits == theUpper ? 'X' : 'x';
         }
     }
 
-    /* adjust the string pointer */
-    return length;
+    npad = spec->width - nprefix - nzero - ndigit;
+
+    if (spec->flags & LP_LADJUST) {
+        OUTPUT(arg, prefix, nprefix);
+        PrintPad(output, arg, '0', nzero);
+        OUTPUT(arg, p, ndigit);
+        PrintPad(output, arg, ' ', npad);
+    } else if ((spec->flags & LP_ZEROPAD) && spec->prec < 0) {
+        OUTPUT(arg, prefix, nprefix);
+        PrintPad(output, arg, '0', nzero + npad);
+        OUTPUT(arg, p, ndigit);
+    } else {
+        PrintPad(output, arg, ' ', npad);
+        OUTPUT(arg, prefix, nprefix);
+        PrintPad(output, arg, '0', nzero);
+        OUTPUT(arg, p, ndigit);
+    }
 }
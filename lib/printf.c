@@ -11,6 +11,9 @@
 
 #include <printf.h>
 #include <print.h>
+#include <prof.h>
+#include <spinlock.h>
+#include <cons.h>
 
 #ifdef __x86_64__
 
@@ -25,16 +28,23 @@ void printcharc(char ch);
 
 void halt(void);
 
+/* Keeps lines from different cpus from interleaving. */
+static struct spinlock printf_lock = SPINLOCK_INITIALIZER("printf");
+
 static void myoutput(void *arg, char *s, int l)
 {
-    int i;
+    int i, j;
 
     // special termination call
-    if ((l==1) && (s[0] == '\0')) return;
-    
-    for (i=0; i< l; i++) {
-	printcharc(s[i]);
-	if (s[i] == '\n') printcharc('\n');
+    if (l == 0) return;
+
+    // every newline goes out twice
+    for (i = 0; i < l; i = j) {
+	for (j = i; j < l && s[j] != '\n'; j++)
+	    ;
+	if (j < l) j++;
+	cons_write(s + i, j - i);
+	if (s[j - 1] == '\n') cons_write("\n", 1);
     }
 }
 
@@ -47,8 +57,62 @@ void printf(char *fmt, ...)
 {
     va_list ap;
     va_start(ap, fmt);
+    spin_lock(&printf_lock);
     lp_Print(myoutput, 0, fmt, ap);
+    spin_unlock(&printf_lock);
+    va_end(ap);
+}
+
+/* state of one vsnprintf() call */
+struct snbuf {
+    char *p;        // next free byte
+    char *end;      // last byte, kept for the terminating '\0'
+    int len;        // chars produced so far, stored or not
+};
+
+static void snoutput(void *arg, char *s, int l)
+{
+    struct snbuf *b = arg;
+    int room = b->end - b->p;
+
+    // special termination call
+    if (l == 0) return;
+
+    b->len += l;
+    if (l > room) l = room;
+    while (l-- > 0)
+        *b->p++ = *s++;
+}
+
+/* Overview:
+ *	Format into buf, storing at most size - 1 chars and always a
+ *	terminating '\0' when size > 0.  Returns the length the whole
+ *	output would have had, so a result >= size means it was cut.
+ */
+int
+vsnprintf(char *buf, int size, const char *fmt, va_list ap)
+{
+    struct snbuf b;
+
+    b.p = buf;
+    b.end = size > 0 ? buf + size - 1 : buf;
+    b.len = 0;
+    lp_Print(snoutput, &b, (char *)fmt, ap);
+    if (size > 0)
+        *b.p = '\0';
+    return b.len;
+}
+
+int
+snprintf(char *buf, int size, const char *fmt, ...)
+{
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(buf, size, fmt, ap);
     va_end(ap);
+    return len;
 }
 
 void
@@ -58,11 +122,14 @@ _panic(const char *file, int line, const char *fmt,...)
 
 
 	va_start(ap, fmt);
+	cons_tx_sync();
 	printf("panic at %s:%d: ", file, line);
 	lp_Print(myoutput, 0, (char *)fmt, ap);
 	printf("\n");
 	va_end(ap);
 
+	prof_dump();
+
 
 	for(;;);
 }
@@ -0,0 +1,220 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <prof.h>
+#include <printf.h>
+#include <trap.h>
+#include <spinlock.h>
+#include <cache.h>
+
+static struct prof_site prof_sites[PROF_NSITE];
+static int prof_nsite;
+static struct spinlock prof_lock = SPINLOCK_INITIALIZER("prof");
+
+/* Absorbs the probes of every site registered after the table filled up. */
+static struct prof_site prof_overflow = { "(overflow)" };
+
+/* Written only by that cpu's clock interrupt. */
+static struct prof_samples {
+	int ps_n;
+	u_int ps_dropped;
+	u_long ps_pc[PROF_NSAMPLE];
+} __attribute__((aligned(CACHE_LINE))) prof_samples[NCPU];
+static volatile int prof_sampling;
+
+/* Overview:
+ *	Give the site whose pointer is *pps an entry, unless another cpu
+ *	did while we waited for the lock.  Returns *pps.
+ */
+struct prof_site *
+prof_register(struct prof_site **pps, const char *name)
+{
+	struct prof_site *ps;
+
+	spin_lock(&prof_lock);
+	if ((ps = *pps) == NULL) {
+		ps = &prof_overflow;
+		if (prof_nsite < PROF_NSITE) {
+			ps = &prof_sites[prof_nsite];
+			ps->ps_name = name;
+			smp_mb();
+			prof_nsite++;
+		}
+		*pps = ps;
+	}
+	spin_unlock(&prof_lock);
+	return ps;
+}
+
+void
+prof_end(struct prof_site *ps, u_int t0)
+{
+	struct prof_count *pc = &ps->ps_cpu[mp_whoami()];
+	u_int d = prof_count() - t0;	// Count wraps, unsigned math copes
+	u_int v;
+	int b;
+
+	if (pc->pc_hits++ == 0 || d < pc->pc_min)
+		pc->pc_min = d;
+	if (d > pc->pc_max)
+		pc->pc_max = d;
+	pc->pc_total += d;
+
+	for (b = 0, v = d >> 1; v && b < PROF_NBUCKET - 1; v >>= 1)
+		b++;
+	pc->pc_hist[b]++;
+}
+
+static void
+prof_reset_site(struct prof_site *ps)
+{
+	struct prof_count *pc;
+	int i, j;
+
+	for (i = 0; i < NCPU; i++) {
+		pc = &ps->ps_cpu[i];
+		pc->pc_hits = 0;
+		pc->pc_min = 0;
+		pc->pc_max = 0;
+		pc->pc_total = 0;
+		for (j = 0; j < PROF_NBUCKET; j++)
+			pc->pc_hist[j] = 0;
+	}
+}
+
+void
+prof_reset(void)
+{
+	int i;
+
+	for (i = 0; i < prof_nsite; i++)
+		prof_reset_site(&prof_sites[i]);
+	prof_reset_site(&prof_overflow);
+}
+
+/* 64 by 32 bit division without libgcc, the quotient must fit in 32 bits. */
+static u_int
+div64(u_quad_t n, u_int d)
+{
+	u_quad_t rem = 0;
+	u_int q = 0;
+	int i;
+
+	for (i = 63; i >= 0; i--) {
+		rem = (rem << 1) | ((n >> i) & 1);
+		q <<= 1;
+		if (rem >= d) {
+			rem -= d;
+			q |= 1;
+		}
+	}
+	return q;
+}
+
+static void
+prof_dump_site(struct prof_site *ps)
+{
+	struct prof_count sum, *pc;
+	int b, i;
+
+	sum.pc_hits = 0;
+	sum.pc_total = 0;
+	sum.pc_min = ~0;
+	sum.pc_max = 0;
+	for (b = 0; b < PROF_NBUCKET; b++)
+		sum.pc_hist[b] = 0;
+
+	for (i = 0; i < NCPU; i++) {
+		pc = &ps->ps_cpu[i];
+		if (pc->pc_hits == 0)
+			continue;
+		sum.pc_hits += pc->pc_hits;
+		sum.pc_total += pc->pc_total;
+		if (pc->pc_min < sum.pc_min)
+			sum.pc_min = pc->pc_min;
+		if (pc->pc_max > sum.pc_max)
+			sum.pc_max = pc->pc_max;
+		for (b = 0; b < PROF_NBUCKET; b++)
+			sum.pc_hist[b] += pc->pc_hist[b];
+	}
+	if (sum.pc_hits == 0)
+		return;
+
+	printf("  %s: hits %u min %u avg %u max %u\n", ps->ps_name,
+		   sum.pc_hits, sum.pc_min, div64(sum.pc_total, sum.pc_hits),
+		   sum.pc_max);
+
+	for (b = 0; b < PROF_NBUCKET; b++)
+		if (sum.pc_hist[b])
+			printf("    >= %u\t%u\n", b ? 1 << b : 0, sum.pc_hist[b]);
+}
+
+void
+prof_dump(void)
+{
+	int i;
+
+	printf("prof: %d sites\n", prof_nsite);
+	for (i = 0; i < prof_nsite; i++)
+		prof_dump_site(&prof_sites[i]);
+	prof_dump_site(&prof_overflow);
+}
+
+void
+prof_sample_start(void)
+{
+	int i;
+
+	for (i = 0; i < NCPU; i++) {
+		prof_samples[i].ps_n = 0;
+		prof_samples[i].ps_dropped = 0;
+	}
+	smp_mb();
+	prof_sampling = 1;
+}
+
+void
+prof_sample_stop(void)
+{
+	prof_sampling = 0;
+}
+
+/* Overview:
+ *	Called from the clock interrupt with the interrupted context.
+ *	Keeps the first PROF_NSAMPLE pcs of a run on this cpu and counts
+ *	the rest.
+ */
+__text_hot void
+prof_tick(struct Trapframe *tf)
+{
+	struct prof_samples *ps = &prof_samples[mp_whoami()];
+
+	if (!prof_sampling)
+		return;
+
+	if (ps->ps_n < PROF_NSAMPLE)
+		ps->ps_pc[ps->ps_n++] = tf->cp0_epc;
+	else
+		ps->ps_dropped++;
+}
+
+/* The line format is parsed by tools/prof_symbolize.sh, keep them in sync. */
+void
+prof_sample_dump(void)
+{
+	struct prof_samples *ps;
+	u_int dropped = 0;
+	int i, j, n = 0;
+
+	for (i = 0; i < NCPU; i++) {
+		n += prof_samples[i].ps_n;
+		dropped += prof_samples[i].ps_dropped;
+	}
+
+	printf("prof-samples begin %d dropped %u\n", n, dropped);
+	for (i = 0; i < NCPU; i++) {
+		ps = &prof_samples[i];
+		for (j = 0; j < ps->ps_n; j++)
+			printf("prof-sample %x\n", ps->ps_pc[j]);
+	}
+	printf("prof-samples end\n");
+}
@@ -0,0 +1,436 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <env.h>
+#include <sched.h>
+#include <smp.h>
+#include <kstats.h>
+#include <kclock.h>
+#include <cons.h>
+#include <prof.h>
+#include <asm/cp0regdef.h>
+
+static struct sleepq {
+	struct spinlock sq_lock;
+	struct Env_tailq sq_envs;
+} __attribute__((aligned(CACHE_LINE))) sleepqs[NSLEEPQ] __cacheline_aligned;
+
+#define SLEEPQ(chan)	(&sleepqs[((u_long)(chan) >> 4) & (NSLEEPQ - 1)])
+
+void
+sched_init(void)
+{
+	struct runq *rq;
+	int i;
+
+	for (i = 0; i < NCPU; i++) {
+		rq = &cpus[i].cpu_runq;
+		spin_init(&rq->rq_lock, "runq");
+		TAILQ_INIT(&rq->rq_envs);
+		rq->rq_len = 0;
+	}
+
+	for (i = 0; i < NSLEEPQ; i++) {
+		spin_init(&sleepqs[i].sq_lock, "sleepq");
+		TAILQ_INIT(&sleepqs[i].sq_envs);
+	}
+}
+
+/* Lock the run queue e sits on.  A thief may move e while we wait. */
+__text_hot static struct runq *
+runq_lock_env(struct Env *e)
+{
+	struct runq *rq;
+
+	for (;;) {
+		rq = &cpus[e->env_cpu].cpu_runq;
+		spin_lock(&rq->rq_lock);
+		if (rq == &cpus[e->env_cpu].cpu_runq)
+			return rq;
+		spin_unlock(&rq->rq_lock);
+	}
+}
+
+/* Overview:
+ *	Make e runnable on the cpu that last ran it, or on this cpu if it
+ *	never ran anywhere.  A held env is queued by sched_release().
+ */
+__text_hot void
+sched_enqueue(struct Env *e)
+{
+	struct runq *rq;
+
+	if (e->env_cpu < 0 || e->env_cpu >= ncpu)
+		e->env_cpu = mycpu()->cpu_id;
+
+	rq = runq_lock_env(e);
+	e->env_status = ENV_RUNNABLE;
+	if (!e->env_held) {
+		TAILQ_INSERT_TAIL(&rq->rq_envs, e, env_sched_link);
+		rq->rq_len++;
+	}
+	spin_unlock(&rq->rq_lock);
+}
+
+/* Take e off rq, locked, if it is on it. */
+static int
+runq_remove(struct runq *rq, struct Env *e)
+{
+	if (e->env_status != ENV_RUNNABLE || e->env_sched_link.tqe_prev == NULL)
+		return 0;
+	TAILQ_REMOVE(&rq->rq_envs, e, env_sched_link);
+	e->env_sched_link.tqe_prev = NULL;
+	rq->rq_len--;
+	return 1;
+}
+
+/* Overview:
+ *	Take e off its run queue, if it is runnable and on one.  Returns 1
+ *	if it was: e then neither runs nor can be picked until
+ *	sched_enqueue(e).  A sleeping env is on a sleep queue through the
+ *	same link and is left alone.
+ */
+__text_hot int
+sched_dequeue(struct Env *e)
+{
+	struct runq *rq;
+	int queued;
+
+	if (e->env_cpu < 0 || e->env_cpu >= ncpu)
+		return 0;
+
+	rq = runq_lock_env(e);
+	queued = runq_remove(rq, e);
+	spin_unlock(&rq->rq_lock);
+	return queued;
+}
+
+/* Overview:
+ *	Mark e held until sched_release(e), off its run queue if it is
+ *	runnable.  Returns 1 if it was queued, or asleep on a channel, and
+ *	nobody held it already; 0 if it is running, held, or blocked some
+ *	other way, such as by env_destroy().
+ */
+int
+sched_hold(struct Env *e)
+{
+	struct runq *rq;
+	int held;
+
+	if (e->env_cpu < 0 || e->env_cpu >= ncpu)
+		return 0;
+
+	rq = runq_lock_env(e);
+	if (e->env_status == ENV_NOT_RUNNABLE)
+		held = e->env_wchan != NULL && !e->env_held;
+	else
+		held = runq_remove(rq, e);
+	if (held)
+		e->env_held = 1;
+	spin_unlock(&rq->rq_lock);
+	return held;
+}
+
+/* Overview:
+ *	Let go of e, taken with sched_hold(): back on its run queue if it
+ *	was runnable or woken meanwhile, unless env_destroy() got to it.
+ */
+void
+sched_release(struct Env *e)
+{
+	struct runq *rq;
+
+	rq = runq_lock_env(e);
+	if (e->env_status == ENV_RUNNABLE) {
+		TAILQ_INSERT_TAIL(&rq->rq_envs, e, env_sched_link);
+		rq->rq_len++;
+	}
+	e->env_held = 0;
+	spin_unlock(&rq->rq_lock);
+}
+
+/* Overview:
+ *	Take e off its run or sleep queue for good, for env_destroy(), and
+ *	wait until nobody holds it any more.
+ */
+void
+sched_forget(struct Env *e)
+{
+	struct sleepq *sq;
+	struct runq *rq;
+	void *chan;
+
+	// the sleep queue lock goes first, as in sched_wakeup_n()
+	if ((chan = e->env_wchan) != NULL) {
+		sq = SLEEPQ(chan);
+		spin_lock(&sq->sq_lock);
+		if (e->env_wchan == chan) {
+			TAILQ_REMOVE(&sq->sq_envs, e, env_sched_link);
+			e->env_sched_link.tqe_prev = NULL;
+			e->env_wchan = NULL;
+		}
+		spin_unlock(&sq->sq_lock);
+	}
+
+	if (e->env_cpu >= 0 && e->env_cpu < ncpu) {
+		rq = runq_lock_env(e);
+		runq_remove(rq, e);
+		e->env_status = ENV_NOT_RUNNABLE;
+		spin_unlock(&rq->rq_lock);
+	} else
+		e->env_status = ENV_NOT_RUNNABLE;
+
+	while (e->env_held)
+		;
+}
+
+/* Overview:
+ *	Move the back half of the busiest other queue to c's queue.
+ *	Returns the number of envs stolen.
+ */
+static int
+sched_steal(struct cpu *c)
+{
+	struct runq *mine = &c->cpu_runq;
+	struct runq *victim = NULL;
+	struct runq *first, *second;
+	struct Env *e, *next;
+	u_int len, best = 0;
+	int i, n;
+
+	for (i = 0; i < ncpu; i++) {
+		len = cpus[i].cpu_runq.rq_len;
+		if (i != c->cpu_id && len > best) {
+			best = len;
+			victim = &cpus[i].cpu_runq;
+		}
+	}
+	if (victim == NULL)
+		return 0;
+
+	// always lock the lower cpu first
+	first = victim < mine ? victim : mine;
+	second = victim < mine ? mine : victim;
+	spin_lock(&first->rq_lock);
+	spin_lock(&second->rq_lock);
+
+	// the queue may have shrunk since we looked; keep its front half
+	n = victim->rq_len / 2;
+	for (e = victim->rq_envs.tqh_first; e && n > 0; n--)
+		e = e->env_sched_link.tqe_next;
+
+	n = 0;
+	for (; e; e = next) {
+		next = e->env_sched_link.tqe_next;
+		TAILQ_REMOVE(&victim->rq_envs, e, env_sched_link);
+		TAILQ_INSERT_TAIL(&mine->rq_envs, e, env_sched_link);
+		e->env_cpu = c->cpu_id;
+		n++;
+	}
+	victim->rq_len -= n;
+	mine->rq_len += n;
+
+	spin_unlock(&second->rq_lock);
+	spin_unlock(&first->rq_lock);
+	return n;
+}
+
+/* Overview:
+ *	Take the next env to run on this cpu off its queue, stealing from
+ *	the busiest cpu when the queue is empty.  Returns NULL if there is
+ *	nothing runnable anywhere.
+ */
+__text_hot struct Env *
+sched_pick(void)
+{
+	struct cpu *c = mycpu();
+	struct runq *rq = &c->cpu_runq;
+	struct Env *e;
+
+	do {
+		spin_lock(&rq->rq_lock);
+		e = rq->rq_envs.tqh_first;
+		if (e != NULL) {
+			TAILQ_REMOVE(&rq->rq_envs, e, env_sched_link);
+			e->env_sched_link.tqe_prev = NULL;
+			rq->rq_len--;
+		}
+		spin_unlock(&rq->rq_lock);
+	} while (e == NULL && sched_steal(c) > 0);
+
+	return e;
+}
+
+/* Overview:
+ *	Put curenv to sleep on chan: not runnable, off its run queue, until
+ *	sched_wakeup(chan).  The caller still has to give up the cpu.
+ */
+__text_hot void
+sched_sleep(void *chan)
+{
+	struct Env *e = curenv;
+	struct sleepq *sq = SLEEPQ(chan);
+	struct runq *rq;
+
+	// not runnable before it goes on the sleep queue, see sched_dequeue()
+	if (e->env_cpu >= 0 && e->env_cpu < ncpu) {
+		rq = runq_lock_env(e);
+		runq_remove(rq, e);
+		e->env_status = ENV_NOT_RUNNABLE;
+		spin_unlock(&rq->rq_lock);
+	} else
+		e->env_status = ENV_NOT_RUNNABLE;
+
+	spin_lock(&sq->sq_lock);
+	e->env_wchan = chan;
+	TAILQ_INSERT_TAIL(&sq->sq_envs, e, env_sched_link);
+	spin_unlock(&sq->sq_lock);
+}
+
+/* Overview:
+ *	Make the first n envs sleeping on chan, in the order they went to
+ *	sleep, runnable again.  Returns how many there were.  Every cpu
+ *	waiting on chan in sched_wait() goes on as well, uncounted.
+ */
+__text_hot u_int
+sched_wakeup_n(void *chan, u_int n)
+{
+	struct sleepq *sq = SLEEPQ(chan);
+	struct Env *e, *next;
+	u_int woken = 0;
+	int i;
+
+	spin_lock(&sq->sq_lock);
+	for (e = sq->sq_envs.tqh_first; e && woken < n; e = next) {
+		next = e->env_sched_link.tqe_next;
+		if (e->env_wchan != chan)
+			continue;
+		TAILQ_REMOVE(&sq->sq_envs, e, env_sched_link);
+		e->env_sched_link.tqe_prev = NULL;
+		e->env_wchan = NULL;
+		sched_enqueue(e);		// ENV_RUNNABLE again
+		woken++;
+	}
+	for (i = 0; i < ncpu; i++)
+		if (cpus[i].cpu_wchan == chan)
+			cpus[i].cpu_wchan = NULL;
+	spin_unlock(&sq->sq_lock);
+	return woken;
+}
+
+/* Overview:
+ *	Make every env sleeping on chan runnable again.
+ */
+__text_hot void
+sched_wakeup(void *chan)
+{
+	sched_wakeup_n(chan, ~0u);
+}
+
+#ifdef __x86_64__
+u_int host_cause(void);		// test.c
+#endif
+
+/* The Cause.IP bits of the interrupts pending here, masked or not. */
+static inline u_int
+intr_pending(void)
+{
+	u_int cause;
+
+#ifdef __x86_64__
+	cause = host_cause();
+#else
+	asm volatile("mfc0 %0, $13" : "=r"(cause));
+#endif
+	return cause & 0xff00;
+}
+
+/*
+ * One round of the idle loop.  The kernel runs with interrupts off, so
+ * the loop takes pending device interrupts itself; the clock is left to
+ * the next env.
+ */
+static void
+sched_idle(struct cpu *c)
+{
+	u_int pending;
+
+	c->cpu_idle++;
+	if ((pending = intr_pending() & ~STATUSF_IP4) != 0)
+		sched_intr(pending);
+	cons_tx_drain();
+}
+
+/* Overview:
+ *	Wait, idling, until sched_wakeup(chan).  Called and returns with lk,
+ *	the lock guarding the event, held.
+ */
+void
+sched_wait(void *chan, struct spinlock *lk)
+{
+	struct cpu *c = mycpu();
+	struct sleepq *sq = SLEEPQ(chan);
+
+	spin_lock(&sq->sq_lock);
+	c->cpu_wchan = chan;
+	spin_unlock(&sq->sq_lock);
+	spin_unlock(lk);
+
+	while (c->cpu_wchan != NULL)
+		sched_idle(c);
+	spin_lock(lk);
+}
+
+/* Overview:
+ *	Give up the cpu: requeue curenv if it is still runnable and run
+ *	the next env, from this cpu's queue or stolen, idling until there
+ *	is one.  Switching to another env counts as a context switch.
+ *	Does not return.
+ */
+__text_hot void
+sched_yield(void)
+{
+	struct cpu *c = mycpu();
+	struct Env *prev = curenv, *e;
+	u_int t = prof_begin();
+
+	// a sleeping or destroyed curenv stays off the run queues
+	if (prev != NULL && prev->env_status == ENV_RUNNABLE)
+		sched_enqueue(prev);
+
+	// its registers are saved: env_run() has nothing to save again
+	curenv = NULL;
+	while ((e = sched_pick()) == NULL) {
+		sched_idle(c);
+		t = prof_begin();	// idling is no part of the switch
+	}
+
+	if (e != prev) {
+		c->cpu_ctxsw++;
+		KSTATS_INC(ks_ctxsw);
+	}
+	prof_end(PROF_SITE(sched_yield), t);
+	env_run(e);
+}
+
+/* Overview:
+ *	The interrupt dispatcher, called by handle_int with the Cause.IP
+ *	bits that are both pending and enabled, and by the idle loop.
+ *	Console input (IRQ 2) is taken and returns to the interrupted
+ *	context; a clock tick (IRQ 4) samples curenv's pc for the profiler
+ *	and ends its time slice.
+ */
+__text_hot void
+sched_intr(int pending)
+{
+	if (pending & STATUSF_IP2)
+		cons_intr();
+	if (pending & STATUSF_IP4) {
+#ifndef __x86_64__
+		*(volatile u_int *)IO_RTC_ACK = 0;
+#endif
+		if (curenv != NULL)
+			prof_tick(&curenv->env_tf);
+		cons_tx_drain();
+		sched_yield();
+	}
+}
@@ -0,0 +1,66 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <smp.h>
+#include <atomic.h>
+#include <printf.h>
+#include <cons.h>
+#include <sched.h>
+
+struct cpu cpus[NCPU] __cacheline_aligned;
+int ncpu = 1;
+
+/* Kernel stacks of the secondary cpus; cpu 0 keeps the boot stack. */
+static u_char cpu_kstack[NCPU - 1][KSTKSIZE] __attribute__((aligned(BY2PG)));
+
+extern void _start_secondary(void);
+
+/* Overview:
+ *	Called by cpu 0 once the console works.  Starts the other cpus one
+ *	at a time and waits for each to check in from mp_main().
+ */
+void
+mp_init(void)
+{
+	int i;
+
+	ncpu = mp_ncpus();
+	if (ncpu > NCPU)
+		ncpu = NCPU;
+	if (ncpu < 1)
+		ncpu = 1;
+
+	cpus[0].cpu_id = 0;
+	cpus[0].cpu_kstacktop = 0x80400000;	// see boot/start.S
+	cpus[0].cpu_started = 1;
+
+	for (i = 1; i < ncpu; i++) {
+		cpus[i].cpu_id = i;
+		cpus[i].cpu_kstacktop = (u_long)cpu_kstack[i - 1] + KSTKSIZE;
+		mb();
+		mp_startcpu(i, (u_long)_start_secondary, cpus[i].cpu_kstacktop);
+		while (!cpus[i].cpu_started)
+			;
+	}
+
+	// the other cpus drain the console while they idle
+	if (ncpu > 1)
+		cons_tx_start();
+
+	printf("mp: %d cpu(s) running\n", ncpu);
+}
+
+/* Overview:
+ *	C entry point of a secondary cpu, on its own stack.  Checks in and
+ *	joins the scheduler for good: with nothing queued here yet, it
+ *	idles in sched_yield() until it can steal an env from another cpu.
+ */
+void
+mp_main(void)
+{
+	struct cpu *c = mycpu();
+
+	mb();
+	c->cpu_started = 1;
+
+	sched_yield();
+}
@@ -0,0 +1,241 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <swap.h>
+#include <pmap.h>
+#include <env.h>
+#include <pgrange.h>
+#include <pmerge.h>
+#include <spinlock.h>
+#include <kstats.h>
+#include <error.h>
+
+struct sw_victim {
+	Pte *v_pte;
+	struct Page *v_page;
+	struct disk_req v_req;
+};
+
+static u_int swap_map[SWAP_NSLOT / 32];	// set bit: slot in use
+static u_int swap_hint;			// where slot_alloc() looks first
+
+// guards swap_map and the Ptes of swapped-out pages
+static struct spinlock swap_lock = SPINLOCK_INITIALIZER("swap");
+
+// guards the hand and sw_victims: one swap_out() at a time
+static struct spinlock clock_lock = SPINLOCK_INITIALIZER("clock");
+static u_int sw_env;			// ENVX() of the env under the hand
+static u_long sw_va;			// the hand, in that env
+static struct sw_victim sw_victims[SWAP_BATCH];
+
+/* Overview:
+ *	Allocate a swap slot, next-fit.  Returns it, or -1 if swap is full.
+ */
+static int
+slot_alloc(void)
+{
+	u_int i, s;
+	int slot = -1;
+
+	spin_lock(&swap_lock);
+	for (i = 0; i < SWAP_NSLOT; i++) {
+		s = (swap_hint + i) % SWAP_NSLOT;
+		if (swap_map[s / 32] == ~0u) {
+			i += 31 - s % 32;
+			continue;
+		}
+		if (!(swap_map[s / 32] & (1u << (s % 32)))) {
+			swap_map[s / 32] |= 1u << (s % 32);
+			swap_hint = s + 1;
+			slot = s;
+			break;
+		}
+	}
+	spin_unlock(&swap_lock);
+	return slot;
+}
+
+/* Free slot; swap_lock is held. */
+static void
+slot_free(u_int slot)
+{
+	swap_map[slot / 32] &= ~(1u << (slot % 32));
+}
+
+static int
+sw_candidate(Pte pte)
+{
+	return (pte & (PTE_V | PTE_UC | PTE_MERGED)) == PTE_V &&
+	       pa2page(pte)->pp_ref == 1;
+}
+
+/* Overview:
+ *	Write out the n victims, whose Ptes already name their slots, and
+ *	free their pages.  A page that could not be written is mapped
+ *	again.  Returns the number of pages freed.
+ */
+static u_int
+sw_flush(struct sw_victim *v, int n)
+{
+	u_int nfreed = 0;
+	Pte pte;
+	int i;
+
+	for (i = 0; i < n; i++)
+		disk_submit(&v[i].v_req);
+	for (i = 0; i < n; i++) {
+		if (disk_wait(&v[i].v_req) < 0) {
+			spin_lock(&swap_lock);
+			pte = *v[i].v_pte;
+			slot_free(PTE_ADDR(pte) >> PGSHIFT);
+			*v[i].v_pte = page2pa(v[i].v_page) |
+				      (pte & 0xfff & ~PTE_SWAP) | PTE_V;
+			spin_unlock(&swap_lock);
+			continue;
+		}
+		page_decref(v[i].v_page);
+		KSTATS_INC(ks_swap_out);
+		nfreed++;
+	}
+	return nfreed;
+}
+
+/* Overview:
+ *	Move the hand on until npage pages have been written out and
+ *	freed, swap is full or the hand went twice around.  Returns the
+ *	number of pages freed.
+ */
+u_int
+swap_out(u_int npage)
+{
+	struct pgrange pr;
+	struct sw_victim *v;
+	struct Env *e;
+	Pte *pte;
+	u_int nfreed = 0, n;
+	int nv, slot, full = 0, changed;
+
+	spin_lock(&clock_lock);
+	for (n = 0; nfreed < npage && !full && n <= 2 * NENV; n++) {
+		e = &envs[sw_env];
+		if (pmap_hold(e)) {
+			nv = changed = 0;
+			pgrange_init(&pr, e->env_pgdir, sw_va, UTOP - sw_va, 0);
+			while (nfreed + nv < npage &&
+			       (pte = pgrange_next(&pr)) != NULL) {
+				if (!sw_candidate(*pte))
+					continue;
+				if (*pte & PTE_A) {
+					// used since the hand last came by
+					*pte &= ~PTE_A;
+					changed = 1;
+					continue;
+				}
+				if ((slot = slot_alloc()) < 0) {
+					full = 1;
+					break;
+				}
+				v = &sw_victims[nv++];
+				v->v_pte = pte;
+				v->v_page = pa2page(*pte);
+				v->v_req.dr_diskno = SWAP_DISKNO;
+				v->v_req.dr_secno = SWAP_SLOT2SECT(slot);
+				v->v_req.dr_write = 1;
+				v->v_req.dr_niov = 1;
+				v->v_req.dr_iov[0].iov_base =
+					(void *)page2kva(v->v_page);
+				v->v_req.dr_iov[0].iov_nsecs = BY2PG / SECT_SIZE;
+				*pte = ((u_long)slot << PGSHIFT) |
+				       (*pte & 0xfff & ~(PTE_V | PTE_A)) | PTE_SWAP;
+				changed = 1;
+				if (nv == SWAP_BATCH) {
+					nfreed += sw_flush(sw_victims, nv);
+					nv = 0;
+				}
+			}
+			nfreed += sw_flush(sw_victims, nv);
+			// the TLB entries of the pages passed go with the rest
+			pmap_release(e, changed);
+			if (pte != NULL && pr.pr_next < UTOP) {
+				sw_va = pr.pr_next;
+				break;
+			}
+		}
+		sw_env = (sw_env + 1) & (NENV - 1);
+		sw_va = 0;
+	}
+	spin_unlock(&clock_lock);
+	return nfreed;
+}
+
+/* Overview:
+ *	page_alloc(), swapping pages out to make room if there is none.
+ */
+int
+swap_page_alloc(struct Page **pp)
+{
+	int r;
+
+	if ((r = page_alloc(pp)) != -E_NO_MEM || swap_out(SWAP_BATCH) == 0)
+		return r;
+	return page_alloc(pp);
+}
+
+/* Overview:
+ *	Read back the page swapped out from va in pgdir.  Returns 0,
+ *	-E_INVAL if nothing was swapped out from there, -E_NO_MEM or
+ *	-E_IO.
+ */
+int
+swap_fault(Pde *pgdir, u_long va)
+{
+	struct Page *pp;
+	Pte *pte, old;
+	int r;
+
+	if (pgdir_walk(pgdir, va, 0, &pte) < 0 || pte == NULL ||
+	    !((old = *pte) & PTE_SWAP))
+		return -E_INVAL;
+	if ((r = swap_page_alloc(&pp)) < 0)
+		return r;
+	if ((r = disk_rw(SWAP_DISKNO, SWAP_SLOT2SECT(PTE_ADDR(old) >> PGSHIFT),
+			 (void *)page2kva(pp), BY2PG / SECT_SIZE, 0)) < 0) {
+		page_free(pp);
+		return r;
+	}
+
+	spin_lock(&swap_lock);
+	if (*pte == old) {
+		slot_free(PTE_ADDR(old) >> PGSHIFT);
+		pp->pp_ref++;
+		*pte = page2pa(pp) | (old & 0xfff & ~PTE_SWAP) | PTE_V | PTE_A;
+		pp = NULL;
+	}
+	spin_unlock(&swap_lock);
+
+	if (pp != NULL)
+		page_free(pp);		// a thread beat us to it
+	else
+		KSTATS_INC(ks_swap_in);
+	tlb_invalidate(pgdir, va);
+	return 0;
+}
+
+/* Overview:
+ *	Free the swap slots of the pages swapped out from [va, va + size)
+ *	in pgdir, for env_free().
+ */
+void
+swap_discard(Pde *pgdir, u_long va, u_long size)
+{
+	struct pgrange pr;
+	Pte *pte;
+
+	pgrange_init(&pr, pgdir, va, size, 0);
+	spin_lock(&swap_lock);
+	while ((pte = pgrange_next(&pr)) != NULL)
+		if (*pte & PTE_SWAP) {
+			slot_free(PTE_ADDR(*pte) >> PGSHIFT);
+			*pte = 0;
+		}
+	spin_unlock(&swap_lock);
+}
@@ -0,0 +1,107 @@
+/* See COPYRIGHT for copyright information. */
+
+#include <thread.h>
+#include <pmap.h>
+#include <pgrange.h>
+#include <sched.h>
+#include <spinlock.h>
+#include <error.h>
+
+// guards pp_ref of the pages holding shared page directories
+static struct spinlock thread_lock = SPINLOCK_INITIALIZER("thread");
+
+/* Overview:
+ *	Create a thread in the address space of leader that starts at pc
+ *	with arg in a0, and queue it on the cpu leader last ran on, where
+ *	the space is most likely loaded.  Returns 0 with the new env in
+ *	*pe, -E_NO_FREE_ENV or -E_NO_MEM.
+ */
+int
+thread_create(struct Env **pe, struct Env *leader, u_long pc, u_long arg)
+{
+	struct Env *e;
+	struct Page *stk, *xstk = NULL;
+	u_long top;
+	int r;
+
+	if ((r = env_take(&e, leader->env_id)) < 0)
+		return r;
+	top = THREAD_STACKTOP(e->env_id);
+
+	if ((r = page_alloc(&stk)) < 0)
+		goto fail;
+	if (leader->env_pgfault_handler && (r = page_alloc(&xstk)) < 0) {
+		page_free(stk);
+		goto fail;
+	}
+	if ((r = page_insert(leader->env_pgdir, stk, top - BY2PG,
+			     PTE_V | PTE_R)) < 0) {
+		page_free(stk);
+		if (xstk)
+			page_free(xstk);
+		goto fail;
+	}
+	if (xstk && (r = page_insert(leader->env_pgdir, xstk,
+				     top - THREAD_STKSIZE, PTE_V | PTE_R)) < 0) {
+		page_remove(leader->env_pgdir, top - BY2PG);
+		page_free(xstk);
+		goto fail;
+	}
+
+	spin_lock(&thread_lock);
+	pa2page(leader->env_cr3)->pp_ref++;
+	spin_unlock(&thread_lock);
+
+	e->env_pgdir = leader->env_pgdir;
+	e->env_cr3 = leader->env_cr3;
+	e->env_asid = leader->env_asid;
+	e->env_pgfault_handler = leader->env_pgfault_handler;
+	e->env_xstacktop = top - THREAD_STKSIZE + BY2PG;
+	e->env_cpu = leader->env_cpu;
+
+	e->env_tf.cp0_status = leader->env_tf.cp0_status;
+	e->env_tf.regs[29] = top;
+	e->env_tf.regs[4] = arg;
+	e->env_tf.cp0_epc = pc;
+	e->env_tf.pc = pc;
+
+	sched_enqueue(e);
+	*pe = e;
+	return 0;
+
+fail:
+	env_put(e);
+	return r;
+}
+
+/* Overview:
+ *	Drop e's hold on its address space, for env_free().  Returns 1 if
+ *	e was the last env using it and the caller tears it down as usual,
+ *	0 if other threads still run in it; then only e's stack slot is
+ *	unmapped.
+ */
+int
+thread_put_space(struct Env *e)
+{
+	struct Page *pp = pa2page(e->env_cr3);
+	int i, last;
+
+	pmap_unmap_range(e->env_pgdir, THREAD_STACKTOP(e->env_id) -
+			 THREAD_STKSIZE, THREAD_STKSIZE);
+
+	spin_lock(&thread_lock);
+	if (!(last = pp->pp_ref == 1))
+		pp->pp_ref--;
+	spin_unlock(&thread_lock);
+
+	if (!last)
+		// the siblings share the ASID: drop the slot from every TLB
+		// before the pages come back as somebody else's
+		tlb_shootdown();
+	else
+		// the page may come back as another env's directory
+		for (i = 0; i < ncpu; i++)
+			if (cpus[i].cpu_cr3 == e->env_cr3)
+				cpus[i].cpu_cr3 = 0;
+	return last;
+}
@@ -0,0 +1,98 @@
+/*
+ * Host (x86_64) implementation of the device routines that drivers/
+ * provides on GXemul.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "test.h"
+
+static void
+stdout_putchar(char ch)
+{
+	putchar(ch);
+}
+
+void (*host_putchar)(char ch) = stdout_putchar;
+
+void printcharc(char ch)
+{
+	host_putchar(ch);
+}
+
+const char *host_input;
+
+int scancharc(void)
+{
+	return host_input && *host_input ? *host_input++ : 0;
+}
+
+/* the console raises IRQ 2 while it has input */
+unsigned int host_cause(void)
+{
+	return host_input && *host_input ? 0x0400 : 0;
+}
+
+void halt(void)
+{
+	exit(0);
+}
+
+int mp_whoami(void)
+{
+	return 0;
+}
+
+int mp_ncpus(void)
+{
+	return 1;
+}
+
+void mp_startcpu(int cpu, unsigned long pc, unsigned long sp)
+{
+}
+
+/* boot/start.S */
+void _start_secondary(void)
+{
+}
+
+unsigned char host_disk[HOST_NDISK][HOST_DISK_NSECS][512];
+int host_disk_ro[HOST_NDISK];
+
+int disk_xfer(int diskno, unsigned int secno, void *buf,
+	      unsigned int nsecs, int write)
+{
+	if (diskno < 0 || diskno >= HOST_NDISK || secno > HOST_DISK_NSECS ||
+	    nsecs > HOST_DISK_NSECS - secno || (write && host_disk_ro[diskno]))
+		return -1;
+	if (write)
+		memcpy(host_disk[diskno][secno], buf, nsecs * 512);
+	else
+		memcpy(buf, host_disk[diskno][secno], nsecs * 512);
+	return 0;
+}
+
+/* user memory: struct Env keeps user addresses in a u_int */
+void *host_usermem(unsigned long size)
+{
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+	return p == MAP_FAILED ? NULL : p;
+}
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE	0x100000
+#endif
+
+/* physical memory, at the kseg0 address KADDR() gives it */
+void *host_physmem(unsigned long size)
+{
+	void *p = mmap((void *)HOST_KSEG0, size, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+	return p == (void *)HOST_KSEG0 ? p : NULL;
+}
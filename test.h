@@ -0,0 +1,65 @@
+/*
+ * Host (x86_64) stand-ins for the GXemul devices, used when lib/ is built
+ * as a host library by CMakeLists.txt.  See test.c.
+ */
+
+#ifndef _TEST_H_
+#define _TEST_H_
+
+/* Where printcharc() sends its characters, stdout by default. */
+extern void (*host_putchar)(char ch);
+
+void printcharc(char ch);
+int scancharc(void);
+void halt(void);
+
+/*
+ * Console input, what scancharc() hands out, or NULL for none.  Cause.IP2
+ * reads pending, see host_cause(), while some is left.
+ */
+extern const char *host_input;
+unsigned int host_cause(void);
+
+/* drivers/gxmp/mp.c: the host is a single cpu */
+int mp_whoami(void);
+int mp_ncpus(void);
+void mp_startcpu(int cpu, unsigned long pc, unsigned long sp);
+
+/*
+ * drivers/gxdisk/disk.c: disks 0 and 1, the file system and swap, are
+ * RAM disks of HOST_DISK_NSECS sectors
+ */
+#define HOST_NDISK	2
+#define HOST_DISK_NSECS	8192
+extern unsigned char host_disk[HOST_NDISK][HOST_DISK_NSECS][512];
+extern int host_disk_ro[HOST_NDISK];	// writes fail while set
+int disk_xfer(int diskno, unsigned int secno, void *buf,
+	      unsigned int nsecs, int write);
+
+/* size bytes of "user" memory below 4GB, or NULL */
+void *host_usermem(unsigned long size);
+
+/*
+ * lib/pmap.c, see test_pmap.c: page_init() maps HOST_NPAGE pages of
+ * physical memory at HOST_KSEG0, where KADDR() puts them.  A Pte is a
+ * u_long here, so page tables and directories take two pages; the first
+ * HOST_NPTPAGE pages are kept for them and host_pgtable() hands them out
+ * zeroed, never to be freed.
+ */
+#define HOST_KSEG0	0x80000000UL
+#define HOST_NPAGE	1024
+#define HOST_NPTPAGE	128
+void *host_physmem(unsigned long size);
+void *host_pgtable(void);
+
+/*
+ * lib/env.c, see test_env.c: env_init(), env_take(), env_put() and an
+ * env_run() that returns.  host_env_new() takes an env with a page
+ * directory of its own, on cpu 0 but not queued, or returns NULL;
+ * host_pte() is the Pte mapping va in it, or NULL.
+ */
+struct Env;
+struct Env *host_env_new(void);
+unsigned long *host_pte(struct Env *e, unsigned long va);
+
+#endif /* _TEST_H_ */
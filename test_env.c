@@ -0,0 +1,101 @@
+/*
+ * Host (x86_64) implementation of the lib/env.c routines the kernel
+ * library calls, see test.h: the env table and its free list, and
+ * env_run().  Address spaces are up to the tests.
+ */
+
+#include <env.h>
+#include <pmap.h>
+#include <spinlock.h>
+#include <error.h>
+#include "test.h"
+
+static struct Env host_envs[NENV];
+struct Env *envs = host_envs;
+
+static struct Env_list env_free_list;
+static struct spinlock env_lock = SPINLOCK_INITIALIZER("env");
+static u_int next_env_id;
+
+void
+env_init(void)
+{
+	int i;
+
+	LIST_INIT(&env_free_list);
+	for (i = NENV - 1; i >= 0; i--) {
+		envs[i].env_status = ENV_FREE;
+		LIST_INSERT_HEAD(&env_free_list, &envs[i], env_link);
+	}
+}
+
+static u_int
+mkenvid(struct Env *e)
+{
+	return (++next_env_id << (1 + LOG2NENV)) | (e - envs);
+}
+
+int
+env_take(struct Env **pe, u_int parent_id)
+{
+	struct Env *e;
+
+	spin_lock(&env_lock);
+	if ((e = env_free_list.lh_first) != NULL)
+		LIST_REMOVE(e, env_link);
+	spin_unlock(&env_lock);
+	if (e == NULL)
+		return -E_NO_FREE_ENV;
+
+	bzero(e, sizeof(struct Env));
+	e->env_id = mkenvid(e);
+	e->env_parent_id = parent_id;
+	e->env_status = ENV_NOT_RUNNABLE;
+	e->env_cpu = -1;
+	*pe = e;
+	return 0;
+}
+
+void
+env_put(struct Env *e)
+{
+	e->env_status = ENV_FREE;
+	spin_lock(&env_lock);
+	LIST_INSERT_HEAD(&env_free_list, e, env_link);
+	spin_unlock(&env_lock);
+}
+
+struct Env *
+host_env_new(void)
+{
+	struct Env *e;
+	Pde *pgdir;
+
+	if ((pgdir = host_pgtable()) == NULL || env_take(&e, 0) < 0)
+		return NULL;
+	e->env_pgdir = pgdir;
+	e->env_cr3 = PADDR(pgdir);
+	pa2page(e->env_cr3)->pp_ref = 1;
+	e->env_cpu = 0;
+	return e;
+}
+
+Pte *
+host_pte(struct Env *e, u_long va)
+{
+	Pte *pte;
+
+	pgdir_walk(e->env_pgdir, va, 0, &pte);
+	return pte;
+}
+
+/* Nothing to load on the host: e is curenv and env_run() returns. */
+void
+env_run(struct Env *e)
+{
+	struct cpu *c = mycpu();
+
+	c->cpu_env = e;
+	e->env_cpu = c->cpu_id;
+	e->env_runs++;
+}
@@ -0,0 +1,137 @@
+/*
+ * Host (x86_64) implementation of the lib/pmap.c routines the kernel
+ * library calls, see test.h.  There is no TLB on the host, so
+ * tlb_invalidate() has nothing to do.
+ */
+
+#include <pmap.h>
+#include <error.h>
+#include "test.h"
+
+struct Page *pages;
+u_long npage;
+
+static struct Page host_pages[HOST_NPAGE];
+static struct Page_list page_free_list;
+static u_long pt_next;			// next page of the page table area
+
+void
+page_init(void)
+{
+	u_long i;
+
+	if (pages == NULL && host_physmem(HOST_NPAGE * BY2PG) == NULL)
+		panic("cannot map physical memory at %08lx", HOST_KSEG0);
+	pages = host_pages;
+	npage = HOST_NPAGE;
+
+	LFSTACK_INIT(&page_free_list);
+	for (i = npage; i-- > HOST_NPTPAGE; ) {
+		pages[i].pp_ref = 0;
+		pages[i].pp_flags = 0;
+		LFSTACK_PUSH(&page_free_list, &pages[i], pp_link);
+	}
+	pt_next = 2;			// env_cr3 0 means no space, see thread.h
+}
+
+void *
+host_pgtable(void)
+{
+	void *pt;
+
+	if (pt_next + 2 > HOST_NPTPAGE)
+		return NULL;
+	pt = (void *)page2kva(&pages[pt_next]);
+	pt_next += 2;
+	bzero(pt, 2 * BY2PG);
+	return pt;
+}
+
+int
+page_alloc(struct Page **pp)
+{
+	if ((*pp = LFSTACK_POP(&page_free_list, Page, pp_link)) == NULL)
+		return -E_NO_MEM;
+	bzero((void *)page2kva(*pp), BY2PG);
+	return 0;
+}
+
+void
+page_free(struct Page *pp)
+{
+	if (pp->pp_ref != 0)
+		panic("page_free: page %ld still has %d refs",
+		      page2ppn(pp), pp->pp_ref);
+	pp->pp_flags = 0;
+	LFSTACK_PUSH(&page_free_list, pp, pp_link);
+}
+
+void
+page_decref(struct Page *pp)
+{
+	if (--pp->pp_ref == 0)
+		page_free(pp);
+}
+
+int
+pgdir_walk(Pde *pgdir, u_long va, int create, Pte **ppte)
+{
+	Pde *pde = &pgdir[PDX(va)];
+	Pte *pt;
+
+	if (!(*pde & PTE_V)) {
+		if (!create) {
+			*ppte = NULL;
+			return 0;
+		}
+		if ((pt = host_pgtable()) == NULL)
+			return -E_NO_MEM;
+		*pde = PADDR(pt) | PTE_V;
+	}
+	*ppte = (Pte *)KADDR(PTE_ADDR(*pde)) + PTX(va);
+	return 0;
+}
+
+int
+page_insert(Pde *pgdir, struct Page *pp, u_long va, u_int perm)
+{
+	Pte *pte;
+
+	if (pgdir_walk(pgdir, va, 1, &pte) < 0)
+		return -E_NO_MEM;
+	pp->pp_ref++;			// first, in case pp is mapped there
+	if (*pte & PTE_V)
+		page_decref(pa2page(*pte));
+	*pte = page2pa(pp) | perm | PTE_V;
+	return 0;
+}
+
+struct Page *
+page_lookup(Pde *pgdir, u_long va, Pte **ppte)
+{
+	Pte *pte;
+
+	pgdir_walk(pgdir, va, 0, &pte);
+	if (ppte)
+		*ppte = pte;
+	if (pte == NULL || !(*pte & PTE_V))
+		return NULL;
+	return pa2page(*pte);
+}
+
+void
+page_remove(Pde *pgdir, u_long va)
+{
+	struct Page *pp;
+	Pte *pte;
+
+	if ((pp = page_lookup(pgdir, va, &pte)) == NULL)
+		return;
+	page_decref(pp);
+	*pte = 0;
+}
+
+void
+tlb_invalidate(Pde *pgdir, u_long va)
+{
+}
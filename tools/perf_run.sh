@@ -0,0 +1,101 @@
+#!/bin/sh
+#
+# Boot gxemul/vmlinux headless with the perf workload (init/perf.c) and
+# compare its numbers against gxemul/perf_baseline.
+#
+#	usage: tools/perf_run.sh [-u]
+#
+# Metrics are the "perf <metric> <value>" lines the workload prints
+# (CP0 Count ticks per phase) plus "instrs", the emulated instruction
+# count from GXemul's -N statistics.  A metric that grows by more than
+# PERF_TOLERANCE percent (default 1) fails the run.  Wall clock time is
+# reported but never compared.  -u rewrites the baseline instead.  A
+# configuration with no baseline file yet only prints its numbers: none
+# is checked in until it has been measured on GXemul.
+#
+# Environment: GXEMUL (emulator binary), PERF_CONFIG (machine config in
+# gxemul/, default r3000), PERF_TAG (baseline name, default the config;
+# "make perf" adds -cached for KSEG0_CACHED=1 kernels), PERF_TIMEOUT
+# (seconds, default 120).
+
+GXEMUL=${GXEMUL:-gxemul}
+PERF_CONFIG=${PERF_CONFIG:-r3000}
+PERF_TAG=${PERF_TAG:-$PERF_CONFIG}
+PERF_TIMEOUT=${PERF_TIMEOUT:-120}
+PERF_TOLERANCE=${PERF_TOLERANCE:-1}
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+baseline=$root/gxemul/perf_baseline.$PERF_TAG
+log=$root/gxemul/perf.log
+results=$root/gxemul/perf.results
+
+update=0
+[ "$1" = "-u" ] && update=1
+
+start=$(date +%s%N)
+(cd "$root/gxemul" && timeout "$PERF_TIMEOUT" "$GXEMUL" -q -N @"$PERF_CONFIG") \
+	> "$log" 2>&1 < /dev/null
+end=$(date +%s%N)
+
+if ! grep -q '^perf done' "$log"; then
+	echo "perf: workload did not finish, see $log" >&2
+	exit 1
+fi
+
+{
+	awk '$1 == "perf" && $2 != "done" { print $2, $3 }' "$log"
+	# last "[ <n> instrs ..." line printed by -N
+	sed -n 's/^.*\[ *\([0-9][0-9]*\) instrs.*$/instrs \1/p' "$log" | tail -n 1
+} > "$results"
+
+echo "perf: wall $(( (end - start) / 1000000 )) ms"
+
+if [ $update -eq 1 ]; then
+	{
+		echo "# perf baseline for $PERF_TAG, \"<metric> <value>\" per line."
+		echo "# Regenerate with \"make perf-update\" after an intended change."
+		cat "$results"
+	} > "$baseline"
+	echo "perf: baseline $baseline updated"
+	cat "$baseline"
+	exit 0
+fi
+
+if [ ! -f "$baseline" ]; then
+	echo "perf: no baseline for $PERF_TAG, nothing compared;" \
+	     "record one with make perf-update" >&2
+	cat "$results"
+	exit 0
+fi
+
+if ! grep -q '^[^#]' "$baseline"; then
+	echo "perf: $baseline has no numbers, record them with make perf-update" >&2
+	exit 1
+fi
+
+awk -v tol="$PERF_TOLERANCE" '
+FILENAME == ARGV[1] { if ($1 !~ /^#/ && NF == 2) base[$1] = $2; next }
+{
+	seen[$1] = 1
+	if (!($1 in base)) {
+		printf "  %-10s %12d  (new)\n", $1, $2
+		next
+	}
+	delta = base[$1] ? 100 * ($2 - base[$1]) / base[$1] : 0
+	status = delta > tol ? "REGRESSION" : ""
+	if (status != "")
+		bad++
+	printf "  %-10s %12d  base %12d  %+7.2f%%  %s\n", $1, $2, base[$1], delta, status
+}
+END {
+	for (m in base)
+		if (!(m in seen)) {
+			printf "  %-10s missing from this run\n", m
+			bad++
+		}
+	exit bad ? 1 : 0
+}' "$baseline" "$results"
+status=$?
+
+[ $status -ne 0 ] && echo "perf: regression over $PERF_TOLERANCE% or missing metric" >&2
+exit $status
@@ -0,0 +1,57 @@
+#!/bin/sh
+#
+# Turn the pc samples printed by prof_sample_dump() into a flat profile.
+#
+#	usage: tools/prof_symbolize.sh console.log [gxemul/vmlinux]
+#
+# console.log is the captured GXemul console output.  Samples are matched
+# against the text symbols of the kernel image; pcs outside any known
+# symbol (user code) are reported per page.  Set NM to override the nm
+# used to read the image.
+
+log=${1:?usage: $0 console.log [vmlinux]}
+image=${2:-gxemul/vmlinux}
+NM=${NM:-/OSLAB/compiler/usr/bin/mips_4KC-nm}
+
+{
+	$NM -n "$image" | awk '$2 ~ /^[tT]$/ { print "sym", $1, $3 }'
+	awk '/^prof-sample / { print "pc", $2 }' "$log"
+} | awk '
+function hex(s,    i, c, v) {
+	v = 0
+	s = tolower(s)
+	for (i = 1; i <= length(s); i++) {
+		c = index("0123456789abcdef", substr(s, i, 1))
+		v = v * 16 + c - 1
+	}
+	return v
+}
+
+BEGIN { nsym = 0 }
+
+$1 == "sym" { addr[nsym] = hex($2); name[nsym] = $3; nsym++; next }
+
+$1 == "pc" {
+	pc = hex($2)
+	total++
+	lo = 0; hi = nsym - 1; found = -1
+	while (lo <= hi) {
+		mid = int((lo + hi) / 2)
+		if (addr[mid] <= pc) { found = mid; lo = mid + 1 } else hi = mid - 1
+	}
+	if (pc < 2147483648)	# kuseg, no kernel symbols there
+		found = -1
+	if (found >= 0)
+		hits[name[found]]++
+	else
+		hits[sprintf("[user page %x]", int(pc / 4096) * 4096)]++
+}
+
+END {
+	if (total == 0) {
+		print "no samples found" > "/dev/stderr"
+		exit 1
+	}
+	for (f in hits)
+		printf "%8d %6.2f%%  %s\n", hits[f], 100 * hits[f] / total, f
+}' | sort -rn